@@ -0,0 +1,90 @@
+#include "aggregate.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace aggregate {
+
+Pairs::Pairs(const csr::Graph& g, const policy::Table& policies) {
+  auto channels = g.channelCount();
+
+  // endpoints of each channel from the adjacency of node A
+  std::vector<uint32_t> channelA(channels), channelB(channels);
+  for(uint32_t u = 0; u < g.nodeCount(); u++) {
+    for(auto i = g.begin(u); i < g.end(u); i++) {
+      auto e = g.edges()[i];
+      if(csr::Graph::direction(e) == 0) {
+        channelA[csr::Graph::channel(e)] = u;
+        channelB[csr::Graph::channel(e)] = g.neighbours()[i];
+      }
+    }
+  }
+
+  // pair of each channel, pairs in order of their first channel
+  std::unordered_map<uint64_t, uint32_t> index;
+  index.reserve(channels);
+  std::vector<uint32_t> pairOf(channels);
+  for(uint32_t c = 0; c < channels; c++) {
+    auto a = std::min(channelA[c], channelB[c]);
+    auto b = std::max(channelA[c], channelB[c]);
+    auto inserted = index.insert({uint64_t(a) << 32 | b,
+                                  static_cast<uint32_t>(nodeA_.size())});
+    if(inserted.second) {
+      nodeA_.push_back(a);
+      nodeB_.push_back(b);
+    }
+    pairOf[c] = inserted.first->second;
+  }
+
+  channelOffsets_.assign(size() + 1, 0);
+  for(uint32_t c = 0; c < channels; c++) {
+    channelOffsets_[pairOf[c] + 1]++;
+  }
+  for(size_t p = 0; p < size(); p++) {
+    channelOffsets_[p + 1] += channelOffsets_[p];
+  }
+  channels_.resize(channels);
+  totalCapacity_.assign(size(), 0);
+  capacity_.assign(2 * size(), 0);
+  std::vector<uint32_t> pos(channelOffsets_.begin(), channelOffsets_.end() - 1);
+  for(uint32_t c = 0; c < channels; c++) {
+    auto p = pairOf[c];
+    auto e = channelA[c] == nodeA_[p] ? 2 * c : 2 * c + 1;
+    channels_[pos[p]++] = e;
+    auto capacity = policies.capacity()[2 * c];
+    totalCapacity_[p] += capacity;
+    // a direction without a policy can't carry anything
+    for(uint32_t d = 0; d < 2; d++) {
+      if(policies.hasPolicy(e ^ d)) {
+        capacity_[2 * p + d] = std::max(capacity_[2 * p + d], capacity);
+      }
+    }
+  }
+
+  adj_ = csr::build(g.nodeCount(), nodeA_, nodeB_);
+}
+
+void Pairs::cost(const std::vector<int64_t>& cost,
+                 const std::vector<uint8_t>& usable,
+                 std::vector<int64_t>& res) const {
+  constexpr auto cNone = policy::cUnpriced;
+  res.resize(2 * size());
+  for(size_t p = 0; p < size(); p++) {
+    for(uint32_t d = 0; d < 2; d++) {
+      int64_t best = cNone;
+      int64_t bestUsable = cNone;
+      for(auto i = channelOffsets_[p]; i < channelOffsets_[p + 1]; i++) {
+        auto e = channels_[i] ^ d;
+        if(cost[e] == cNone) {
+          continue;
+        }
+        best = std::min(best, cost[e]);
+        if(usable[e]) {
+          bestUsable = std::min(bestUsable, cost[e]);
+        }
+      }
+      res[2 * p + d] = bestUsable != cNone ? bestUsable : best;
+    }
+  }
+}
+}
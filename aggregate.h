@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "csr.h"
+#include "policy.h"
+
+// parallel channels between the same two nodes merged into one pair.
+//
+// pairs are numbered in the order of their first channel and form a
+// csr::Graph of their own, with pairs in place of channels: edge id
+// 2 * pair routes from node A to node B of the pair, 2 * pair + 1 back.
+// neighbours keep the order of the channel adjacency, without repeats.
+namespace aggregate {
+
+class Pairs
+{
+public:
+  Pairs(const csr::Graph& g, const policy::Table& policies);
+
+  size_t size() const { return nodeA_.size(); }
+  csr::Graph graph() const { return adj_.graph(); }
+
+  uint32_t nodeA(size_t p) const { return nodeA_[p]; }
+  uint32_t nodeB(size_t p) const { return nodeB_[p]; }
+  // number of channels between the two nodes
+  size_t channelCount(size_t p) const {
+    return channelOffsets_[p + 1] - channelOffsets_[p];
+  }
+  // sum over the channels, millisatoshi
+  int64_t totalCapacity(size_t p) const { return totalCapacity_[p]; }
+
+  // per pair edge: largest single channel with a policy in that
+  // direction, millisatoshi. a payment can't be split over the channels
+  // of a pair.
+  const std::vector<int64_t>& capacity() const { return capacity_; }
+
+  // per pair edge: cheapest of the channels that can carry the amount
+  // (usable, see policy::Table), or of all if none can. channels without
+  // a policy in that direction are skipped, policy::cUnpriced if no
+  // channel has one. cost and usable are indexed by channel edge id.
+  void cost(const std::vector<int64_t>& cost,
+            const std::vector<uint8_t>& usable,
+            std::vector<int64_t>& res) const;
+
+private:
+  csr::Arrays adj_;
+  std::vector<uint32_t> nodeA_;
+  std::vector<uint32_t> nodeB_;
+  // channels of pair p are channels_[channelOffsets_[p], channelOffsets_[p + 1]),
+  // as edge ids routing from the pair's node A
+  std::vector<uint32_t> channelOffsets_;
+  std::vector<uint32_t> channels_;
+  std::vector<int64_t> totalCapacity_;
+  std::vector<int64_t> capacity_;
+};
+}
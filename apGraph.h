@@ -5,24 +5,64 @@
 #include <iostream>
 #include <list>
 #include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
 #include <vector>
-#include <stack>
-#include <unordered_set>
+
+#include "bounds.h"
+#include "csr.h"
+#include "dobfs.h"
+#include "hyperanf.h"
+#include "msbfs.h"
+#include "parallel.h"
+#include "reduce.h"
 
 #define NIL static_cast<size_t>(-1)
 
 namespace AP {
 
+// biconnected components and articulation points as flat arrays.
+// components and nodes form the block-cut tree: a node is linked to every
+// component it is part of, articulation points are the nodes linked to
+// more than one.
 struct Result {
-  std::unordered_set<size_t> articulationPoints;
-  std::vector<std::unordered_set<size_t>> biconnectedComponents;
+  // nodes of component c are
+  // componentNodes[componentOffsets[c]] .. componentNodes[componentOffsets[c + 1] - 1]
+  std::vector<uint32_t> componentOffsets{0};
+  std::vector<uint32_t> componentNodes;
+  // articulation points in the order they were found
+  std::vector<uint32_t> articulationPoints;
+  // bit u % 64 of word u / 64 is set if u is an articulation point
+  std::vector<uint64_t> articulation;
+  // number of components node u is part of, more than one for
+  // articulation points and none for isolated nodes
+  std::vector<uint32_t> componentCounts;
+  // last component node u was added to: its only one, or for an
+  // articulation point the one towards the root of the DFS tree.
+  // UINT32_MAX for isolated nodes
+  std::vector<uint32_t> componentIds;
+  // components of node u are
+  // nodeComponents[nodeOffsets[u]] .. nodeComponents[nodeOffsets[u + 1] - 1]
+  std::vector<uint32_t> nodeOffsets;
+  std::vector<uint32_t> nodeComponents;
+
+  size_t componentCount() const { return componentOffsets.size() - 1; }
+  csr::Range component(size_t c) const {
+    return {componentNodes.data() + componentOffsets[c],
+            componentNodes.data() + componentOffsets[c + 1]};
+  }
+  bool isArticulationPoint(size_t u) const {
+    return (articulation[u / 64] >> (u % 64)) & 1;
+  }
+  // the components containing node u, its neighbours in the block-cut tree
+  csr::Range components(size_t u) const {
+    return {nodeComponents.data() + nodeOffsets[u],
+            nodeComponents.data() + nodeOffsets[u + 1]};
+  }
 
   long long countComponentsForVertex(size_t node) const {
-    return count_if(biconnectedComponents.begin(),
-                    biconnectedComponents.end(),
-                    [node](std::unordered_set<size_t> set){
-      return set.count(node) > 0;
-    });
+    return componentCounts[node];
   }
 };
 
@@ -31,221 +71,387 @@ struct Edge {
   size_t v;
 };
 
+// how getDistances() finds the eccentricities
+enum class Engine {
+  Bfs,   // one breadth first search per source
+  DoBfs, // one direction optimizing search per source, see dobfs.h
+  MsBfs, // 64 sources per search, see msbfs.h
+  Bounds // searches from a few sources bound the others, see bounds.h
+};
+
+// "bfs", "dobfs", "msbfs" or "bounds"
+Engine parseEngine(const std::string& name) {
+  if(name == "bfs") {
+    return Engine::Bfs;
+  } else if(name == "dobfs") {
+    return Engine::DoBfs;
+  } else if(name == "msbfs") {
+    return Engine::MsBfs;
+  } else if(name == "bounds") {
+    return Engine::Bounds;
+  }
+  throw std::runtime_error("unknown distance engine " + name);
+}
+
 // A class that represents an undirected graph
+// the adjacency is shared, g has to outlive the Graph
+// with a reduction the distances are computed on the nodes that were not
+// pruned and derived for the pruned trees.
+// getDistances() runs the searches from all sources with engine on
+// threads threads, 0 = one per core. only Bfs uses the reduction, the
+// other engines search the whole graph. Bounds runs on one thread.
 class Graph
 {
 public:
-  Graph(size_t V);
-
-  void addEdge(size_t v, size_t w);   // function to add an edge to graph
+  Graph(const csr::Graph& g, const reduce::Reduction* reduction = nullptr,
+        size_t threads = 1, Engine engine = Engine::Bfs);
 
   Result getResult();
-  std::vector<size_t> getDistances();
+  // eccentricity of every node. with MsBfs pairs is set to the number of
+  // node pairs by distance (see msbfs::Result), other engines clear it.
+  std::vector<size_t> getDistances(std::vector<uint64_t>* pairs = nullptr);
+  // radius, diameter, center and periphery from the result of getDistances
+  bounds::Extremes getExtremes(const std::vector<size_t>& distances);
+  // approximate distances between all pairs of nodes, see hyperanf.h
+  hyperanf::Result getNeighbourhood(unsigned log2Registers);
 
 private:
+  const csr::Graph& g;
+  const reduce::Reduction* reduction;
   size_t V;    // No. of vertices
-  std::vector<std::vector<size_t>> adj; // adjacency matrix
-  void recurseDFS(size_t v,
-                  int d,
-                  std::vector<bool>& visited,
-                  std::vector<int>& depth,
-                  std::vector<int>& low,
-                  std::vector<size_t>& parent,
-                  std::stack<Edge>& stack,
-                  Result& result);
-  std::unordered_set<size_t> handleEdges(std::stack<Edge>& stack,
-                                         size_t u,
-                                         size_t v);
-  size_t bfs(size_t start);
+  size_t threads;
+  Engine engine;
+
+  // buffers of one thread, reused by all its searches
+  struct Search {
+    std::vector<size_t> distance; // NIL for nodes not reached
+    std::vector<size_t> queue;
+  };
+
+  void dfs(size_t root,
+           std::vector<bool>& visited,
+           std::vector<int>& depth,
+           std::vector<int>& low,
+           std::vector<size_t>& parent,
+           std::vector<Edge>& stack,
+           Result& result);
+  void handleEdges(std::vector<Edge>& stack,
+                   size_t u,
+                   size_t v,
+                   Result& result);
+  static void linkComponents(size_t nodes, Result& result);
+  size_t bfs(size_t start, Search& search);
+  std::vector<size_t> getReducedDistances();
 };
 
-Graph::Graph(size_t V)
-{
-  this->V = V;
-  adj.resize(V);
-}
-
-void Graph::addEdge(size_t u, size_t v)
+Graph::Graph(const csr::Graph& g, const reduce::Reduction* reduction,
+             size_t threads, Engine engine) :
+  g(g)
+, reduction(reduction)
+, V(g.nodeCount())
+, threads(threads)
+, engine(engine)
 {
-  adj[u].push_back(v);
-  adj[v].push_back(u);  // Note: the graph is undirected
 }
 
 // handles stack of edges in case an articulation point is found,
 // so we can keep track of the biconnected components.
-// return value is the set of nodes that are in one biconnected component.
-std::unordered_set<size_t> Graph::handleEdges(std::stack<Edge>& stack, size_t u, size_t v) {
-  std::unordered_set<size_t> nodes;
-  while(true) {
-    auto edge = stack.top();
-    nodes.insert(edge.u);
-    nodes.insert(edge.v);
-    stack.pop();
+// the nodes of the edges up to (u, v) are added to result as one
+// biconnected component, counting the components of every node.
+// u == NIL takes all remaining edges.
+void Graph::handleEdges(std::vector<Edge>& stack, size_t u, size_t v,
+                        Result& result) {
+  auto c = static_cast<uint32_t>(result.componentCount());
+  auto add = [&](size_t x) {
+    if(result.componentIds[x] != c) {
+      result.componentIds[x] = c;
+      result.componentCounts[x]++;
+      result.componentNodes.push_back(static_cast<uint32_t>(x));
+    }
+  };
+  while(!stack.empty()) {
+    auto edge = stack.back();
+    add(edge.u);
+    add(edge.v);
+    stack.pop_back();
     if((edge.u == u && edge.v == v) || (edge.v == u && edge.u == v)){
-      return nodes;
+      break;
     }
   }
+  if(result.componentNodes.size() > result.componentOffsets.back()) {
+    result.componentOffsets.push_back(
+      static_cast<uint32_t>(result.componentNodes.size()));
+  }
 }
 
-size_t Graph::bfs(size_t start)
+// builds the per node component lists of the block-cut tree
+void Graph::linkComponents(size_t nodes, Result& result) {
+  result.nodeOffsets.assign(nodes + 1, 0);
+  for(size_t u = 0; u < nodes; u++) {
+    result.nodeOffsets[u + 1] = result.nodeOffsets[u] + result.componentCounts[u];
+  }
+  result.nodeComponents.resize(result.componentNodes.size());
+  std::vector<uint32_t> next(result.nodeOffsets.begin(),
+                             result.nodeOffsets.end() - 1);
+  for(size_t c = 0; c < result.componentCount(); c++) {
+    for(auto x : result.component(c)) {
+      result.nodeComponents[next[x]++] = static_cast<uint32_t>(c);
+    }
+  }
+}
+
+// hop distance to the farthest node reachable from start
+size_t Graph::bfs(size_t start, Search& search)
 {
-  std::deque<size_t> queue;     //Double-ended queue
-  std::vector<size_t> distance(V, NIL);
-  std::vector<bool> visited(V, false);
+  auto& distance = search.distance;
+  auto& queue = search.queue;
+  if(distance.empty()) {
+    distance.assign(V, NIL);
+  }
 
+  queue.clear();
   queue.push_back(start);
   distance[start] = 0;
-  while(!queue.empty ())
-  {
-    auto u = queue.front();
-    visited[u] = true;
-    queue.pop_front();
-    for(auto i = adj[u].begin(); i != adj[u].end(); ++i)
-    {
-      size_t v = *i;  // v is current adjacent of u
-
-      /* if distance of neighbour of v from start node is greater than sum of distance of v from start node and edge weight between v and its neighbour (distance between v and its neighbour of v) ,then change it */
-
-      if(distance[u] + 1 < distance[v])
-      {
+  for(size_t head = 0; head < queue.size(); head++) {
+    auto u = queue[head];
+    for(size_t v : g.neighbours(u)) {
+      if(distance[v] == NIL) {
         distance[v] = distance[u] + 1;
-
-        /*if edge weight between v and its neighbour is 0 then push it to front of
-        double ended queue else push it to back*/
-
         queue.push_back(v);
       }
     }
   }
 
-  size_t maxDistance = 0;
-  for(size_t i = 0; i < V; i ++){
-    if(visited[i]) {
-      maxDistance = std::max(maxDistance, distance[i]);
-    }
+  // nodes are queued by distance, the last one is the farthest
+  size_t maxDistance = distance[queue.back()];
+  for(auto u : queue) {
+    distance[u] = NIL;
   }
-
   return maxDistance;
 }
 
-// A recursive function that find articulation points using DFS traversal
-// u --> The vertex to be visited next
+// finds articulation points using a DFS traversal from root.
+// the traversal keeps its own stack of frames instead of recursing, so the
+// depth of the DFS tree isn't limited by the call stack.
 // visited --> keeps track of visited vertices
 // depth --> Stores depth of visited vertices in DFS tree
+// low --> lowest depth reachable from the subtree of a vertex
 // parent --> Stores parent vertices in DFS tree
-// ap --> Store articulation points
 // stack --> The stack of edges to keep track of biconnected components
-// d --> current depth
-void Graph::recurseDFS(size_t u,
-                       int d,
-                       std::vector<bool>& visited,
-                       std::vector<int>& depth,
-                       std::vector<int>& low,
-                       std::vector<size_t>& parent,
-                       std::stack<Edge>& stack,
-                       Result& result)
+void Graph::dfs(size_t root,
+                std::vector<bool>& visited,
+                std::vector<int>& depth,
+                std::vector<int>& low,
+                std::vector<size_t>& parent,
+                std::vector<Edge>& stack,
+                Result& result)
 {
-  bool isArticulation = false;
-  // Count of children in DFS Tree
-  int children = 0;
-
-  // Mark the current node as visited
-  visited[u] = true;
-
-  // Initialize depth and low value
-  depth[u] = low[u] = d;
-
-  // Go through all vertices aadjacent to this
-  for (auto i = adj[u].begin(); i != adj[u].end(); ++i)
-  {
-    size_t v = *i;  // v is current adjacent of u
-
-    // If v is not visited yet, then make it a child of u
-    // in DFS tree and recurse for it
-    if (!visited[v]) {
-      children++;
-      parent[v] = u;
-      stack.push({u, v});
-      recurseDFS(v, d + 1, visited, depth, low, parent, stack, result);
-
-      // Check if the subtree rooted with v has a connection to
-      // one of the ancestors of u
-      low[u] = std::min(low[u], low[v]);
-
-      // node is articulation point when one of the following is true
-      if(parent[u] == NIL && children > 1) {
-        // (1) u is root of DFS tree and has two or more chilren.
-        isArticulation = true;
-
-        // add biconnected component to result
-        auto nodes = handleEdges(stack, u, v);
-        result.biconnectedComponents.push_back(nodes);
-      } else if(parent[u] != NIL && low[v] >= depth[u]){
-        // (2) If u is not root and low value of one of its children is more
-        // than depth value of u.
-        isArticulation = true;
-
-        // add biconnected component to result
-        auto nodes = handleEdges(stack, u, v);
-        result.biconnectedComponents.push_back(nodes);
+  // a vertex on the DFS path
+  struct Frame {
+    size_t u;
+    uint32_t next;     // next adjacency entry to look at
+    int children;      // Count of children in DFS Tree
+    bool isArticulation;
+  };
+  std::vector<Frame> frames;
+
+  auto visit = [&](size_t u, int d) {
+    visited[u] = true;
+    depth[u] = low[u] = d;
+    frames.push_back({u, g.begin(u), 0, false});
+  };
+  visit(root, 0);
+
+  while(!frames.empty()) {
+    auto& f = frames.back();
+    size_t u = f.u;
+    if(f.next < g.end(u)) {
+      size_t v = g.neighbours()[f.next++];
+      // If v is not visited yet, then make it a child of u
+      // in DFS tree and continue with it
+      if(!visited[v]) {
+        f.children++;
+        parent[v] = u;
+        stack.push_back({u, v});
+        visit(v, depth[u] + 1);
+      } else if(v != parent[u]) {
+        // Update low value of u for parent function calls.
+        low[u] = std::min(low[u], depth[v]);
       }
-    } else if (v != parent[u]) {
-      // Update low value of u for parent function calls.
-      low[u] = std::min(low[u], depth[v]);
-//      stack.push({u, v}); this somehow fucks up the result. without everything is fine
+      continue;
+    }
+
+    // all neighbours of u are done, return to its parent
+    if(f.isArticulation) {
+      result.articulationPoints.push_back(static_cast<uint32_t>(u));
+      result.articulation[u / 64] |= uint64_t(1) << (u % 64);
+    }
+    frames.pop_back();
+    if(frames.empty()) {
+      break;
+    }
+    auto& p = frames.back();
+    size_t w = p.u;
+
+    // Check if the subtree rooted with u has a connection to
+    // one of the ancestors of w
+    low[w] = std::min(low[w], low[u]);
+
+    // node is articulation point when one of the following is true
+    // (1) w is root of DFS tree and has two or more chilren.
+    // (2) If w is not root and low value of one of its children is more
+    // than depth value of w.
+    if((parent[w] == NIL && p.children > 1)
+       || (parent[w] != NIL && low[u] >= depth[w])) {
+      p.isArticulation = true;
+
+      // add biconnected component to result
+      handleEdges(stack, w, u, result);
     }
-  }
-  if (isArticulation) {
-    // add node to result
-    result.articulationPoints.insert(u);
   }
 }
 
 Result Graph::getResult()
 {
   // Mark all the vertices as not visited
-  std::vector<bool> visited(V);
+  std::vector<bool> visited(V, false);
   std::vector<int> depth(V);
   std::vector<int> low(V);
-  std::vector<size_t> parent(V);
-  std::stack<Edge> stack;
+  std::vector<size_t> parent(V, NIL);
+  std::vector<Edge> stack;
   Result result;
+  result.articulation.assign((V + 63) / 64, 0);
+  result.componentCounts.assign(V, 0);
+  result.componentIds.assign(V, UINT32_MAX);
 
-  // Initialize parent and visited, and ap(articulation point) arrays
-  for (size_t i = 0; i < V; i++)
-  {
-    parent[i] = NIL;
-    visited[i] = false;
-  }
-
-  // Call the recursive helper function to find articulation points
-  // in DFS tree rooted with vertex 'i'
+  // find articulation points in DFS tree rooted with vertex 'i'
   for (size_t i = 0; i < V; i++) {
     if (visited[i] == false) {
-      recurseDFS(i, 0, visited, depth, low, parent, stack, result);
+      dfs(i, visited, depth, low, parent, stack, result);
 
       // add remaining edges from the stack to the result
       // this is our last remaining biconnected component.
-      std::unordered_set<size_t> nodes;
-      while(stack.size() > 0){
-        nodes.insert(stack.top().u);
-        nodes.insert(stack.top().v);
-        stack.pop();
-      }
-      if(nodes.size() > 0) {
-        result.biconnectedComponents.push_back(nodes);
-      }
+      handleEdges(stack, NIL, NIL, result);
     }
   }
+  linkComponents(V, result);
   return result;
 }
 
-std::vector<size_t> Graph::getDistances()
+std::vector<size_t> Graph::getDistances(std::vector<uint64_t>* pairs)
 {
-  std::vector<size_t> res;
-  for(size_t i = 0; i < V; i ++){
-    auto distance = bfs(i);
-    res.push_back(distance);
+  if(pairs) {
+    pairs->clear();
+  }
+  if(engine == Engine::MsBfs) {
+    auto res = msbfs::run(g, threads);
+    if(pairs) {
+      *pairs = std::move(res.pairs);
+    }
+    return std::move(res.eccentricity);
+  }
+  if(engine == Engine::Bounds) {
+    return bounds::eccentricities(g);
+  }
+  if(engine == Engine::DoBfs) {
+    std::vector<size_t> res(V);
+    std::vector<dobfs::Bfs> searches(parallel::threadCount(threads),
+                                     dobfs::Bfs(g));
+    parallel::forEach(V, threads, [&](size_t t, size_t i) {
+      res[i] = searches[t].run(i);
+    });
+    return res;
+  }
+  if(reduction) {
+    return getReducedDistances();
+  }
+  std::vector<size_t> res(V);
+  std::vector<Search> searches(parallel::threadCount(threads));
+  parallel::forEach(V, threads, [&](size_t t, size_t i) {
+    res[i] = bfs(i, searches[t]);
+  });
+  return res;
+}
+
+bounds::Extremes Graph::getExtremes(const std::vector<size_t>& distances)
+{
+  return bounds::extremes(g, distances);
+}
+
+hyperanf::Result Graph::getNeighbourhood(unsigned log2Registers)
+{
+  return hyperanf::run(g, log2Registers, threads);
+}
+
+// every path from a pruned node to the rest of the graph leaves its tree
+// through the anchor, so bfs only runs from and over the other nodes,
+// adding the height of the trees hanging at each reached node.
+// the tree nodes are then done top down: the farthest node is either
+// below them or reached through their parent.
+std::vector<size_t> Graph::getReducedDistances()
+{
+  auto& r = *reduction;
+
+  // height of the pruned subtree below a node, best and second best
+  // height + 1 over its pruned children
+  std::vector<size_t> height(V, 0);
+  std::vector<size_t> best(V, 0);
+  std::vector<size_t> second(V, 0);
+  std::vector<size_t> bestChild(V, NIL);
+  for(size_t x : r.pruned) {
+    size_t p = r.parent[x];
+    size_t h = height[x] + 1;
+    if(h > best[p]) {
+      second[p] = best[p];
+      best[p] = h;
+      bestChild[p] = x;
+    } else if(h > second[p]) {
+      second[p] = h;
+    }
+    height[p] = best[p];
+  }
+
+  std::vector<size_t> res(V, 0);
+  // farthest node that isn't in a tree hanging at the node itself
+  std::vector<size_t> farthest(V, 0);
+  std::vector<Search> searches(parallel::threadCount(threads));
+  parallel::forEach(V, threads, [&](size_t t, size_t s) {
+    if(r.kind[s] == reduce::Tree) {
+      return;
+    }
+    auto& distance = searches[t].distance;
+    auto& queue = searches[t].queue;
+    if(distance.empty()) {
+      distance.assign(V, NIL);
+    }
+    queue.clear();
+    queue.push_back(s);
+    distance[s] = 0;
+    for(size_t head = 0; head < queue.size(); head++) {
+      auto u = queue[head];
+      for(size_t v : g.neighbours(u)) {
+        if(r.kind[v] != reduce::Tree && distance[v] == NIL) {
+          distance[v] = distance[u] + 1;
+          farthest[s] = std::max(farthest[s], distance[v] + height[v]);
+          queue.push_back(v);
+        }
+      }
+    }
+    res[s] = std::max(height[s], farthest[s]);
+    for(auto u : queue) {
+      distance[u] = NIL;
+    }
+  });
+
+  // farthest node outside the subtree of a pruned node
+  std::vector<size_t> up(V, 0);
+  for(auto i = r.pruned.rbegin(); i != r.pruned.rend(); ++i) {
+    size_t x = *i;
+    size_t p = r.parent[x];
+    size_t sibling = bestChild[p] == x ? second[p] : best[p];
+    size_t above = r.kind[p] == reduce::Tree ? up[p] : farthest[p];
+    up[x] = 1 + std::max(sibling, above);
+    res[x] = std::max(height[x], up[x]);
   }
   return res;
 }
@@ -0,0 +1,177 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "dobfs.h"
+
+namespace bounds {
+
+std::vector<size_t> eccentricities(const csr::Graph& g, size_t* searches) {
+  auto nodes = g.nodeCount();
+  std::vector<size_t> res(nodes, 0);
+  std::vector<size_t> lower(nodes, 0);
+  std::vector<size_t> upper(nodes, std::numeric_limits<size_t>::max());
+  std::vector<bool> open(nodes, false);     // eccentricity not known yet
+  std::vector<bool> searched(nodes, false); // was a source
+  std::vector<bool> seen(nodes, false);     // component was handled
+  size_t count = 0;
+
+  // a leaf is one hop farther from everything than its neighbour, so it
+  // is never searched from or bounded
+  auto leaf = [&](size_t u) { return g.degree(u) == 1; };
+  auto parent = [&](size_t u) -> size_t { return g.neighbours(u).first[0]; };
+
+  // the leaves of v are one hop farther than v from all other nodes
+  auto hasLeaf = [&](size_t v) {
+    for(auto u : g.neighbours(v)) {
+      if(leaf(u)) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // applies the search from v with eccentricity e that from ran
+  auto bound = [&](const dobfs::Bfs& from, size_t v, size_t e) {
+    size_t extra = hasLeaf(v) ? 1 : 0;
+    searched[v] = true;
+    for(auto w : from.reached()) {
+      if(!open[w]) {
+        continue;
+      }
+      size_t d = from.distance(w);
+      lower[w] = std::max(lower[w], std::max(d + extra, e - d));
+      upper[w] = std::min(upper[w], e + d);
+      if(lower[w] == upper[w]) {
+        res[w] = lower[w];
+        open[w] = false;
+      }
+    }
+  };
+
+  dobfs::Bfs bfs(g);
+  auto search = [&](size_t v) {
+    count++;
+    bound(bfs, v, bfs.run(v));
+  };
+
+  dobfs::Bfs ref(g);
+  for(size_t s = 0; s < nodes; s++) {
+    if(seen[s]) {
+      continue;
+    }
+    bfs.run(s);
+    count++;
+    std::vector<uint32_t> component = bfs.reached();
+    for(auto u : component) {
+      seen[u] = true;
+    }
+    if(component.size() <= 2) {
+      for(auto u : component) {
+        res[u] = component.size() - 1;
+      }
+      continue;
+    }
+
+    // the levels around the node with the most channels
+    auto z = *std::max_element(component.begin(), component.end(),
+                               [&](uint32_t a, uint32_t b) {
+      return g.degree(a) < g.degree(b);
+    });
+    for(auto u : component) {
+      open[u] = !leaf(u);
+    }
+    // the search from z also orders the sources by level
+    count++;
+    bound(ref, z, ref.run(z));
+    auto& levels = ref.reached();
+
+    for(size_t end = levels.size(); end > 1;) {
+      size_t i = ref.distance(levels[end - 1]);
+      auto begin = end;
+      while(ref.distance(levels[begin - 1]) == i) {
+        begin--;
+      }
+      for(size_t k = begin; k < end; k++) {
+        auto v = leaf(levels[k]) ? parent(levels[k]) : levels[k];
+        if(!searched[v]) {
+          search(v);
+        }
+      }
+      end = begin;
+
+      // every node that wasn't searched is at most i - 1 hops from z
+      bool any = false;
+      for(auto w : component) {
+        if(open[w]) {
+          size_t d = ref.distance(w);
+          upper[w] = std::min(upper[w], std::max(lower[w], d + i - 1));
+          if(lower[w] == upper[w]) {
+            res[w] = lower[w];
+            open[w] = false;
+          } else {
+            any = true;
+          }
+        }
+      }
+      if(!any) {
+        break;
+      }
+    }
+
+    for(auto u : component) {
+      if(leaf(u)) {
+        res[u] = res[parent(u)] + 1;
+      }
+    }
+  }
+
+  if(searches) {
+    *searches = count;
+  }
+  return res;
+}
+
+Extremes extremes(const csr::Graph& g, const std::vector<size_t>& eccentricity) {
+  auto nodes = g.nodeCount();
+  Extremes res;
+  for(auto e : eccentricity) {
+    res.diameter = std::max(res.diameter, e);
+  }
+  for(size_t u = 0; u < nodes; u++) {
+    if(eccentricity[u] == res.diameter) {
+      res.periphery.push_back(static_cast<uint32_t>(u));
+    }
+  }
+
+  // nodes of the largest component
+  dobfs::Bfs bfs(g);
+  std::vector<bool> seen(nodes, false);
+  std::vector<uint32_t> largest;
+  for(size_t u = 0; u < nodes; u++) {
+    if(seen[u]) {
+      continue;
+    }
+    bfs.run(u);
+    for(auto w : bfs.reached()) {
+      seen[w] = true;
+    }
+    if(bfs.reached().size() > largest.size()) {
+      largest = bfs.reached();
+    }
+  }
+
+  res.radius = res.diameter;
+  for(auto u : largest) {
+    res.radius = std::min(res.radius, eccentricity[u]);
+  }
+  for(auto u : largest) {
+    if(eccentricity[u] == res.radius) {
+      res.center.push_back(u);
+    }
+  }
+  std::sort(res.center.begin(), res.center.end());
+  return res;
+}
+}
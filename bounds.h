@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "csr.h"
+
+// exact eccentricities from a few breadth first searches, combining the
+// bounds of Takes and Kosters ("Computing the Eccentricity Distribution of
+// Large Graphs") with the source order of iFUB.
+// a search from v with eccentricity e bounds every node w it reaches:
+// max(d(v, w), e - d(v, w)) <= ecc(w) <= e + d(v, w). sources are taken
+// level by level from the fringe of a breadth first search from the node
+// with the most channels, z. once the levels i and above were searched,
+// every other node is at most d(w, z) + i - 1 hops from w, which bounds
+// ecc(w) from above. nodes whose bounds meet are done, on small world
+// graphs usually long before the inner levels are reached.
+// leaves are one hop farther from everything than their neighbour and are
+// never searched.
+namespace bounds {
+
+// eccentricity of every node, the hops to the farthest node it reaches.
+// searches is set to the number of breadth first searches that were run,
+// including the ones that find the components.
+std::vector<size_t> eccentricities(const csr::Graph& g,
+                                   size_t* searches = nullptr);
+
+struct Extremes {
+  size_t radius = 0;   // smallest eccentricity in the largest component
+  size_t diameter = 0; // largest eccentricity
+  std::vector<uint32_t> center;    // largest component nodes with radius
+  std::vector<uint32_t> periphery; // nodes with diameter
+};
+
+Extremes extremes(const csr::Graph& g, const std::vector<size_t>& eccentricity);
+}
@@ -0,0 +1,288 @@
+#include "loader.h"
+
+#include <stdexcept>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+#include "ingest.h"
+#include "inputBuffer.h"
+#include "numeric.h"
+
+using json = nlohmann::json;
+using namespace ingest;
+
+namespace {
+
+// one direction of a channel as listed by listchannels
+struct HalfChannel {
+  std::string scid;
+  PubKey source;
+  PubKey destination;
+  bool hasSource = false;
+  bool hasDestination = false;
+  int64_t capacity = 0; // satoshi
+  bool active = true;
+  int64_t fee = 0;
+  int64_t feerate = 0;
+  int64_t lastUpdate = 0;
+  std::string error;
+};
+
+// SAX consumer for core lightning's listnodes and listchannels output.
+// container depth: 1 = root object, 2 = "nodes"/"channels" array,
+// 3 = node/channel record (nested values like addresses are skipped).
+class ClnSax : public json::json_sax_t
+{
+public:
+  ClnSax(Graph& g, std::vector<EdgeRecord>& edges) :
+    g_(g)
+  , edges_(edges)
+  {
+  }
+
+  bool null() override {
+    return true;
+  }
+
+  bool boolean(bool val) override {
+    if(depth_ == 3 && section_ == Section::Channels && key_ == "active") {
+      half_.active = val;
+    }
+    return true;
+  }
+
+  bool number_integer(number_integer_t val) override {
+    if(val < 0) {
+      if(amountField()) {
+        malformed(half_.error, key_, std::to_string(val));
+      }
+      return true;
+    }
+    return number_unsigned(static_cast<number_unsigned_t>(val));
+  }
+
+  bool number_unsigned(number_unsigned_t val) override {
+    if(auto field = amountField()) {
+      if(val > static_cast<number_unsigned_t>(INT64_MAX)) {
+        malformed(half_.error, key_, std::to_string(val));
+      } else {
+        *field = static_cast<int64_t>(val);
+        if(key_ == "amount_msat") {
+          *field /= 1000;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool number_float(number_float_t, const string_t& val) override {
+    if(amountField()) {
+      malformed(half_.error, key_, val);
+    }
+    return true;
+  }
+
+  bool string(string_t& val) override {
+    if(depth_ != 3) {
+      return true;
+    }
+    if(section_ == Section::Nodes) {
+      if(key_ == "nodeid") {
+        hasNodeId_ = true;
+        parsePubKey(val, node_.id, node_.error, key_);
+      } else if(key_ == "alias") {
+        node_.name.swap(val);
+      }
+    } else if(section_ == Section::Channels) {
+      if(key_ == "short_channel_id") {
+        half_.scid.swap(val);
+      } else if(key_ == "source") {
+        half_.hasSource = true;
+        parsePubKey(val, half_.source, half_.error, key_);
+      } else if(key_ == "destination") {
+        half_.hasDestination = true;
+        parsePubKey(val, half_.destination, half_.error, key_);
+      } else if(auto field = amountField()) {
+        std::string_view text(val);
+        if(key_ == "amount_msat") {
+          // older versions print "<n>msat"
+          if(text.size() > 4 && text.substr(text.size() - 4) == "msat") {
+            text.remove_suffix(4);
+          }
+          // only a complete value is converted to satoshi
+          int64_t msat;
+          if(numeric::parseAmount(text, msat)) {
+            *field = msat / 1000;
+          } else {
+            malformed(half_.error, key_, text);
+          }
+        } else {
+          parseAmount(text, *field, half_.error, key_);
+        }
+      }
+    }
+    return true;
+  }
+
+  bool start_object(std::size_t) override {
+    depth_++;
+    if(depth_ == 3) {
+      node_ = NodeRecord{};
+      half_ = HalfChannel{};
+      hasNodeId_ = false;
+    }
+    return true;
+  }
+
+  bool key(string_t& val) override {
+    if(depth_ <= 3) {
+      key_.swap(val);
+    }
+    return true;
+  }
+
+  bool end_object() override {
+    if(depth_ == 3) {
+      if(section_ == Section::Nodes) {
+        if(!hasNodeId_) {
+          malformed(node_.error, "nodeid", "");
+        }
+        addNode(g_, node_);
+      } else if(section_ == Section::Channels) {
+        merge();
+      }
+    }
+    depth_--;
+    return true;
+  }
+
+  bool start_array(std::size_t) override {
+    depth_++;
+    if(depth_ == 2) {
+      if(key_ == "nodes") {
+        section_ = Section::Nodes;
+      } else if(key_ == "channels") {
+        section_ = Section::Channels;
+      }
+    }
+    return true;
+  }
+
+  bool end_array() override {
+    if(depth_ == 2) {
+      section_ = Section::None;
+    }
+    depth_--;
+    return true;
+  }
+
+  bool parse_error(std::size_t position,
+                   const std::string& lastToken,
+                   const nlohmann::detail::exception& ex) override {
+    throw std::runtime_error("parse error at byte " + std::to_string(position)
+                             + " near '" + lastToken + "': " + ex.what());
+  }
+
+private:
+  enum class Section { None, Nodes, Channels };
+
+  int64_t* amountField() {
+    if(depth_ != 3 || section_ != Section::Channels) {
+      return nullptr;
+    }
+    if(key_ == "satoshis" || key_ == "amount_msat") {
+      return &half_.capacity;
+    } else if(key_ == "base_fee_millisatoshi") {
+      return &half_.fee;
+    } else if(key_ == "fee_per_millionth") {
+      return &half_.feerate;
+    } else if(key_ == "last_update") {
+      return &half_.lastUpdate;
+    }
+    return nullptr;
+  }
+
+  // adds the direction to its channel. node A is the lesser pub_key,
+  // like node_id_1 of the channel announcement, so direction 0 is
+  // routing from node A.
+  void merge() {
+    uint64_t scid;
+    if(!numeric::parseShortChannelId(half_.scid, scid)) {
+      g_.errors.push_back("channel " + half_.scid + ": malformed short_channel_id");
+      return;
+    }
+    // a missing endpoint would become an all zero pub_key
+    if(!half_.hasSource) {
+      malformed(half_.error, "source", "");
+    }
+    if(!half_.hasDestination) {
+      malformed(half_.error, "destination", "");
+    }
+
+    auto inserted = channels_.insert({scid, edges_.size()});
+    if(inserted.second) {
+      EdgeRecord edge;
+      edge.id = scid;
+      edge.nodeA = std::min(half_.source, half_.destination);
+      edge.nodeB = std::max(half_.source, half_.destination);
+      edge.capacity = half_.capacity;
+      edges_.push_back(std::move(edge));
+    }
+    auto& edge = edges_[inserted.first->second];
+
+    if(!half_.error.empty() && edge.error.empty()) {
+      edge.error = half_.error;
+    }
+    int direction = half_.source == edge.nodeA ? 0 : 1;
+    auto other = direction == 0 ? edge.nodeB : edge.nodeA;
+    if(half_.source != (direction == 0 ? edge.nodeA : edge.nodeB)
+       || half_.destination != other) {
+      malformed(edge.error, "source", encodePubKey(half_.source));
+    }
+
+    auto& policy = edge.policy[direction];
+    policy.present = true;
+    policy.disabled = !half_.active;
+    policy.fee = half_.fee;
+    policy.feerate = half_.feerate;
+    policy.lastUpdate = half_.lastUpdate;
+  }
+
+  Graph& g_;
+  std::vector<EdgeRecord>& edges_;
+  std::unordered_map<uint64_t, size_t> channels_; // scid -> edges_ index
+
+  int depth_ = 0;
+  Section section_ = Section::None;
+  std::string key_;
+
+  NodeRecord node_;
+  bool hasNodeId_ = false;
+  HalfChannel half_;
+};
+
+void parse(const std::string& file, ClnSax& sax) {
+  InputBuffer in(file);
+  json::sax_parse(in.begin(), in.end(), &sax);
+}
+}
+
+Graph graphFromCln(const std::string& channelsFile,
+                   const std::string& nodesFile,
+                   const Filter& filter) {
+  Graph g;
+  std::vector<EdgeRecord> edges;
+  ClnSax sax(g, edges);
+  if(!nodesFile.empty()) {
+    parse(nodesFile, sax);
+  }
+  parse(channelsFile, sax);
+
+  // channels in order of their first direction
+  for(auto& edge : edges) {
+    addEdge(g, edge, filter);
+  }
+  finish(g, filter);
+  return g;
+}
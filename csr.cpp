@@ -0,0 +1,31 @@
+#include "csr.h"
+
+namespace csr {
+
+Arrays build(size_t nodes, const std::vector<uint32_t>& nodeA,
+             const std::vector<uint32_t>& nodeB) {
+  Arrays res;
+  res.channels = nodeA.size();
+  res.offsets.assign(nodes + 1, 0);
+  for(size_t c = 0; c < res.channels; c++) {
+    res.offsets[nodeA[c] + 1]++;
+    res.offsets[nodeB[c] + 1]++;
+  }
+  for(size_t n = 0; n < nodes; n++) {
+    res.offsets[n + 1] += res.offsets[n];
+  }
+
+  res.neighbours.resize(2 * res.channels);
+  res.edges.resize(2 * res.channels);
+  std::vector<uint32_t> pos(res.offsets.begin(), res.offsets.end() - 1);
+  for(uint32_t c = 0; c < res.channels; c++) {
+    auto a = nodeA[c];
+    auto b = nodeB[c];
+    res.neighbours[pos[a]] = b;
+    res.edges[pos[a]++] = 2 * c;
+    res.neighbours[pos[b]] = a;
+    res.edges[pos[b]++] = 2 * c + 1;
+  }
+  return res;
+}
+}
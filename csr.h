@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace csr {
+
+// contiguous range of adjacency entries
+struct Range {
+  const uint32_t* first;
+  const uint32_t* last;
+
+  const uint32_t* begin() const { return first; }
+  const uint32_t* end() const { return last; }
+  size_t size() const { return static_cast<size_t>(last - first); }
+};
+
+// immutable compressed sparse row adjacency of the channel graph.
+// every channel appears once in the adjacency of each of its endpoints.
+// the entries of node u are [begin(u), end(u)) of neighbours() and edges(),
+// ordered by channel number. edges() holds the directed edge id of each
+// entry: 2 * channel for routing from node A to node B, 2 * channel + 1
+// for routing from B to A. per-direction data (costs, capacities) is kept
+// in arrays indexed by that id.
+// Graph doesn't own the arrays, see Arrays or snapshot::Snapshot.
+class Graph
+{
+public:
+  Graph(size_t nodes, size_t channels, const uint32_t* offsets,
+        const uint32_t* neighbours, const uint32_t* edges) :
+    nodes_(nodes)
+  , channels_(channels)
+  , offsets_(offsets)
+  , neighbours_(neighbours)
+  , edges_(edges)
+  {
+  }
+
+  size_t nodeCount() const { return nodes_; }
+  size_t channelCount() const { return channels_; }
+  size_t edgeCount() const { return 2 * channels_; }
+
+  uint32_t begin(size_t u) const { return offsets_[u]; }
+  uint32_t end(size_t u) const { return offsets_[u + 1]; }
+  size_t degree(size_t u) const { return offsets_[u + 1] - offsets_[u]; }
+
+  Range neighbours(size_t u) const {
+    return {neighbours_ + offsets_[u], neighbours_ + offsets_[u + 1]};
+  }
+  Range edges(size_t u) const {
+    return {edges_ + offsets_[u], edges_ + offsets_[u + 1]};
+  }
+
+  const uint32_t* offsets() const { return offsets_; }
+  const uint32_t* neighbours() const { return neighbours_; }
+  const uint32_t* edges() const { return edges_; }
+
+  static uint32_t channel(uint32_t edge) { return edge >> 1; }
+  static uint32_t direction(uint32_t edge) { return edge & 1; }
+
+private:
+  size_t nodes_;
+  size_t channels_;
+  const uint32_t* offsets_;    // [nodes + 1]
+  const uint32_t* neighbours_; // [2 * channels]
+  const uint32_t* edges_;      // [2 * channels]
+};
+
+// owning storage for a csr::Graph
+struct Arrays {
+  size_t channels = 0;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> neighbours;
+  std::vector<uint32_t> edges;
+
+  Graph graph() const {
+    return {offsets.size() - 1, channels,
+            offsets.data(), neighbours.data(), edges.data()};
+  }
+};
+
+// builds the adjacency from the channel endpoints (channel c connects
+// nodeA[c] and nodeB[c]).
+Arrays build(size_t nodes, const std::vector<uint32_t>& nodeA,
+             const std::vector<uint32_t>& nodeB);
+}
@@ -0,0 +1,229 @@
+#include "decompress.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace decompress {
+
+namespace {
+
+using Sink = std::function<bool(std::vector<char>&&)>;
+
+// both decoders hand out chunks of up to chunkSize bytes to sink
+// until the input is exhausted or sink returns false.
+
+#ifdef HAVE_ZLIB
+void gunzip(const char* data, size_t size, size_t chunkSize, const Sink& sink) {
+  z_stream zs{};
+  // 15 + 32: maximum window, detect gzip or zlib header
+  if(inflateInit2(&zs, 15 + 32) != Z_OK) {
+    throw std::runtime_error("inflateInit failed");
+  }
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  zs.avail_in = 0;
+  size_t remaining = size;
+
+  std::vector<char> chunk(chunkSize);
+  zs.next_out = reinterpret_cast<Bytef*>(chunk.data());
+  zs.avail_out = static_cast<uInt>(chunk.size());
+  while(true) {
+    if(zs.avail_in == 0 && remaining > 0) {
+      // avail_in is 32 bit, feed large inputs in pieces
+      zs.avail_in = static_cast<uInt>(std::min<size_t>(remaining, 1u << 30));
+      remaining -= zs.avail_in;
+    }
+    auto res = inflate(&zs, Z_NO_FLUSH);
+    if(res == Z_STREAM_END && (zs.avail_in > 0 || remaining > 0)) {
+      // concatenated gzip members
+      res = inflateReset(&zs);
+    }
+    if(res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR) {
+      std::string msg = zs.msg ? zs.msg : "unknown error";
+      inflateEnd(&zs);
+      throw std::runtime_error("gzip: " + msg);
+    }
+    bool end = res == Z_STREAM_END
+               || (res == Z_BUF_ERROR && zs.avail_in == 0 && remaining == 0);
+    if(zs.avail_out == 0 || end) {
+      chunk.resize(chunk.size() - zs.avail_out);
+      if(!chunk.empty() && !sink(std::move(chunk))) {
+        break;
+      }
+      if(end) {
+        if(res != Z_STREAM_END) {
+          inflateEnd(&zs);
+          throw std::runtime_error("gzip: truncated input");
+        }
+        break;
+      }
+      chunk = std::vector<char>(chunkSize);
+      zs.next_out = reinterpret_cast<Bytef*>(chunk.data());
+      zs.avail_out = static_cast<uInt>(chunk.size());
+    }
+  }
+  inflateEnd(&zs);
+}
+#endif
+
+#ifdef HAVE_ZSTD
+void unzstd(const char* data, size_t size, size_t chunkSize, const Sink& sink) {
+  auto ds = ZSTD_createDStream();
+  if(!ds) {
+    throw std::runtime_error("ZSTD_createDStream failed");
+  }
+  ZSTD_inBuffer in{data, size, 0};
+  std::vector<char> chunk(chunkSize);
+  ZSTD_outBuffer out{chunk.data(), chunk.size(), 0};
+  size_t res = 0;
+  while(true) {
+    res = ZSTD_decompressStream(ds, &out, &in);
+    if(ZSTD_isError(res)) {
+      ZSTD_freeDStream(ds);
+      throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(res));
+    }
+    // res == 0: a frame is complete and fully flushed
+    bool end = in.pos == in.size && (res == 0 || out.pos < out.size);
+    if(out.pos == out.size || end) {
+      chunk.resize(out.pos);
+      if(!chunk.empty() && !sink(std::move(chunk))) {
+        break;
+      }
+      if(end) {
+        if(res != 0) {
+          ZSTD_freeDStream(ds);
+          throw std::runtime_error("zstd: truncated input");
+        }
+        break;
+      }
+      chunk = std::vector<char>(chunkSize);
+      out = {chunk.data(), chunk.size(), 0};
+    }
+  }
+  ZSTD_freeDStream(ds);
+}
+#endif
+
+void decode(const char* data, size_t size, Format format,
+            [[maybe_unused]] size_t chunkSize, const Sink& sink) {
+  switch(format) {
+  case Format::None:
+    if(size > 0) {
+      sink(std::vector<char>(data, data + size));
+    }
+    return;
+  case Format::Gzip:
+#ifdef HAVE_ZLIB
+    gunzip(data, size, chunkSize, sink);
+    return;
+#else
+    throw std::runtime_error("gzip input, but built without zlib");
+#endif
+  case Format::Zstd:
+#ifdef HAVE_ZSTD
+    unzstd(data, size, chunkSize, sink);
+    return;
+#else
+    throw std::runtime_error("zstd input, but built without libzstd");
+#endif
+  }
+}
+}
+
+Format detect(const char* data, size_t size) {
+  static const unsigned char gzip[] = {0x1f, 0x8b};
+  static const unsigned char zstd[] = {0x28, 0xb5, 0x2f, 0xfd};
+  if(size >= sizeof(gzip) && std::memcmp(data, gzip, sizeof(gzip)) == 0) {
+    return Format::Gzip;
+  }
+  if(size >= sizeof(zstd) && std::memcmp(data, zstd, sizeof(zstd)) == 0) {
+    return Format::Zstd;
+  }
+  return Format::None;
+}
+
+std::vector<char> all(const char* data, size_t size, Format format) {
+  std::vector<char> res;
+  decode(data, size, format, 16 << 20, [&](std::vector<char>&& chunk) {
+    res.insert(res.end(), chunk.begin(), chunk.end());
+    return true;
+  });
+  return res;
+}
+
+Streambuf::Streambuf(const char* data, size_t size, Format format) :
+  thread_(&Streambuf::run, this, data, size, format)
+{
+}
+
+Streambuf::~Streambuf()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  changed_.notify_all();
+  thread_.join();
+}
+
+void Streambuf::rethrow() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(error_) {
+    std::rethrow_exception(error_);
+  }
+}
+
+Streambuf::int_type Streambuf::underflow() {
+  if(gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() { return !queue_.empty() || finished_; });
+  if(queue_.empty()) {
+    return traits_type::eof();
+  }
+  current_ = std::move(queue_.front());
+  queue_.pop_front();
+  lock.unlock();
+  changed_.notify_all();
+
+  setg(current_.data(), current_.data(), current_.data() + current_.size());
+  return traits_type::to_int_type(*gptr());
+}
+
+bool Streambuf::push(std::vector<char>&& chunk) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() { return queue_.size() < cQueueSize || stop_; });
+  if(stop_) {
+    return false;
+  }
+  queue_.push_back(std::move(chunk));
+  lock.unlock();
+  changed_.notify_all();
+  return true;
+}
+
+void Streambuf::run(const char* data, size_t size, Format format) {
+  try {
+    decode(data, size, format, cChunkSize,
+           [this](std::vector<char>&& chunk) { return push(std::move(chunk)); });
+  } catch(...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    error_ = std::current_exception();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+  }
+  changed_.notify_all();
+}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+// transparent decompression of archived graph dumps.
+// gzip needs zlib (HAVE_ZLIB), zstd needs libzstd (HAVE_ZSTD).
+namespace decompress {
+
+enum class Format { None, Gzip, Zstd };
+
+// detects the format by its magic bytes
+Format detect(const char* data, size_t size);
+
+// decompresses all of data into memory
+std::vector<char> all(const char* data, size_t size, Format format);
+
+// input stream buffer that decompresses data on a background thread.
+// decompressed chunks are handed over through a small bounded queue, so
+// decompression overlaps with whatever reads from the stream and the
+// decompressed data is never held in memory as a whole.
+// data has to stay valid for the lifetime of the Streambuf.
+class Streambuf : public std::streambuf
+{
+public:
+  Streambuf(const char* data, size_t size, Format format);
+  ~Streambuf() override;
+
+  Streambuf(const Streambuf&) = delete;
+  Streambuf& operator=(const Streambuf&) = delete;
+
+  // rethrows an error of the decompression thread. the stream itself
+  // only sees an early end of input in that case.
+  void rethrow() const;
+
+protected:
+  int_type underflow() override;
+
+private:
+  static constexpr size_t cChunkSize = 1 << 20;
+  static constexpr size_t cQueueSize = 4;
+
+  void run(const char* data, size_t size, Format format);
+  // called by the decompressor, false if the reader went away
+  bool push(std::vector<char>&& chunk);
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<std::vector<char>> queue_;
+  std::vector<char> current_;
+  bool finished_ = false;
+  bool stop_ = false;
+  std::exception_ptr error_;
+
+  std::thread thread_;
+};
+}
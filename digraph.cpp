@@ -2,73 +2,305 @@
 
 namespace digraph {
 
-Graph::Graph(size_t nNodes) :
-  V_(nNodes)
-, dist_(V_, std::vector<int64_t>(V_, cInfinity))
-, next_(V_, std::vector<size_t>(V_, cInfinity))
-, cap_(V_, std::vector<int64_t>(V_, 0))
+namespace {
+
+int64_t add(int64_t a, int64_t b) {
+  return a == cInfinity || b == cInfinity ? cInfinity : a + b;
+}
+}
+
+Graph::Graph(const csr::Graph& g,
+             const std::vector<int64_t>& cost,
+             const std::vector<int64_t>& capacity,
+             const reduce::Reduction* reduction) :
+  g_(g)
+, edgeCost_(cost)
+, edgeCapacity_(capacity)
+, r_(reduction ? *reduction : reduce::none(g.nodeCount()))
+, V_(g.nodeCount())
+, K_(r_.core.size())
 {
 }
 
-void Graph::addEdge(size_t u, size_t v, int64_t fee, int64_t capacity) {
-  dist_[u][v] = fee;
-  next_[u][v] = v;
-  cap_[u][v] = capacity;
+// cost of the pair edge from u to v if it can carry amount
+int64_t Graph::edge(size_t u, size_t v, int64_t amount) const {
+  for(auto i = g_.begin(u); i < g_.end(u); i++) {
+    if(g_.neighbours()[i] == v) {
+      auto e = g_.edges()[i];
+      return edgeCapacity_[e] >= amount ? edgeCost_[e] : cInfinity;
+    }
+  }
+  return cInfinity;
 }
 
-void Graph::floydWarshall(int64_t amount) {
+// fills the core matrices with the direct edges and the chains between
+// core nodes, and the costs along trees and chains.
+void Graph::prepare(int64_t amount) {
+  auto extend = [](Prefix p, int64_t cost) {
+    if(cost == cInfinity) {
+      p.missing++;
+    } else {
+      p.cost += cost;
+    }
+    return p;
+  };
+
+  up_.assign(V_, Prefix());
+  down_.assign(V_, Prefix());
+  for(auto i = r_.pruned.rbegin(); i != r_.pruned.rend(); ++i) {
+    auto p = r_.parent[*i];
+    up_[*i] = extend(up_[p], edge(*i, p, amount));
+    down_[*i] = extend(down_[p], edge(p, *i, amount));
+  }
+
+  dist_.assign(K_, std::vector<int64_t>(K_, cInfinity));
+  next_.assign(K_, std::vector<size_t>(K_, cInfinity));
+  for(size_t a = 0; a < K_; a++) {
+    auto u = r_.core[a];
+    for(auto i = g_.begin(u); i < g_.end(u); i++) {
+      auto b = r_.coreIndex[g_.neighbours()[i]];
+      auto e = g_.edges()[i];
+      if(b != reduce::cNone && edgeCapacity_[e] >= amount) {
+        dist_[a][b] = edgeCost_[e];
+        next_[a][b] = b;
+      }
+    }
+  }
+
+  forward_.assign(r_.chainNodes.size(), Prefix());
+  backward_.assign(r_.chainNodes.size(), Prefix());
+  superEdges_.clear();
+  for(uint32_t c = 0; c < r_.chainCount(); c++) {
+    auto first = r_.chainOffsets[c];
+    auto last = r_.chainOffsets[c + 1] - 1;
+    for(auto s = first + 1; s <= last; s++) {
+      auto prev = r_.chainNodes[s - 1];
+      auto node = r_.chainNodes[s];
+      forward_[s] = extend(forward_[s - 1], edge(prev, node, amount));
+      backward_[s] = extend(backward_[s - 1], edge(node, prev, amount));
+    }
+    auto a = r_.coreIndex[r_.chainNodes[first]];
+    auto b = r_.coreIndex[r_.chainNodes[last]];
+    if(a == b) {
+      continue;
+    }
+    auto hop = [&](uint32_t from, uint32_t to, Prefix p, uint32_t id) {
+      if(p.missing == 0 && p.cost < dist_[from][to]) {
+        dist_[from][to] = p.cost;
+        next_[from][to] = to;
+        superEdges_[uint64_t(from) << 32 | to] = id;
+      }
+    };
+    hop(a, b, forward_[last], 2 * c);
+    hop(b, a, backward_[last], 2 * c + 1);
+  }
+}
+
+void Graph::floydWarshall(int64_t amount, bool cached) {
   // https://en.wikipedia.org/wiki/Floyd%E2%80%93Warshall_algorithm
   // with path reconstruction
+  prepare(amount);
   hash_ = hash(dist_, amount);
-  if(!readCache()) {
-    for(size_t k = 0; k < V_; k++) {
-      for(size_t i = 0; i < V_; i++) {
-        for(size_t j = 0; j < V_; j++) {
+  if(!cached || !readCache()) {
+    for(size_t k = 0; k < K_; k++) {
+      for(size_t i = 0; i < K_; i++) {
+        for(size_t j = 0; j < K_; j++) {
           if(i == j || i == k || k == j
              || dist_[i][k] == cInfinity
-             || dist_[k][j] == cInfinity
-             || cap_[i][k] < amount
-             || cap_[k][j] < amount) {
+             || dist_[k][j] == cInfinity) {
             continue;
           } else if(dist_[i][j] > dist_[i][k] + dist_[k][j]) {
             dist_[i][j] = dist_[i][k] + dist_[k][j];
             next_[i][j] = next_[i][k];
-            cap_[i][j] = std::min(cap_[i][k], cap_[k][j]);
           }
         }
       }
     }
-    writeCache();
+    if(cached) {
+      writeCache();
+    }
   }
 }
 
-bool Graph::isPath(size_t u, size_t v) {
-  return next_[u][v] != cInfinity;
+// the core nodes through which x's tree or chain can be left/entered
+size_t Graph::portals(size_t x, Portal* res) const {
+  auto total = [](const Prefix& p) {
+    return p.missing ? cInfinity : p.cost;
+  };
+  auto diff = [](const Prefix& a, const Prefix& b) {
+    return a.missing != b.missing ? cInfinity : a.cost - b.cost;
+  };
+  auto a = r_.anchor[x];
+  auto out = total(up_[x]);
+  auto in = total(down_[x]);
+  if(r_.kind[a] != reduce::Chain) {
+    res[0] = {r_.coreIndex[a], 0, out, in};
+    return 1;
+  }
+  auto s = r_.slot[a];
+  auto first = r_.chainOffsets[r_.chain[a]];
+  auto last = r_.chainOffsets[r_.chain[a] + 1] - 1;
+  res[0] = {r_.coreIndex[r_.chainNodes[first]], 0,
+            add(out, total(backward_[s])), add(total(forward_[s]), in)};
+  res[1] = {r_.coreIndex[r_.chainNodes[last]], 1,
+            add(out, diff(forward_[last], forward_[s])),
+            add(diff(backward_[last], backward_[s]), in)};
+  return 2;
 }
 
-bool Graph::isInPath(size_t u, size_t v, size_t x) {
-  if(next_[u][v] == cInfinity) {
-    return false;
+// lowest common ancestor of two nodes with the same anchor
+size_t Graph::lca(size_t u, size_t v) const {
+  while(r_.depth[u] > r_.depth[v]) {
+    u = r_.parent[u];
+  }
+  while(r_.depth[v] > r_.depth[u]) {
+    v = r_.parent[v];
   }
   while(u != v) {
-    u = next_[u][v];
-    if(u == x) {
-      return true;
+    u = r_.parent[u];
+    v = r_.parent[v];
+  }
+  return u;
+}
+
+Graph::Route Graph::route(size_t u, size_t v) const {
+  Route res;
+  auto cu = r_.coreIndex[u];
+  auto cv = r_.coreIndex[v];
+  if(cu != reduce::cNone && cv != reduce::cNone) {
+    res.cost = dist_[cu][cv];
+    res.from = cu;
+    res.to = cv;
+    return res;
+  }
+  if(u == v) {
+    return res;
+  }
+
+  auto diff = [](const Prefix& a, const Prefix& b) {
+    return a.missing != b.missing ? cInfinity : a.cost - b.cost;
+  };
+  auto a = r_.anchor[u];
+  auto b = r_.anchor[v];
+  if(a == b) {
+    auto l = lca(u, v);
+    res.cost = add(diff(up_[u], up_[l]), diff(down_[v], down_[l]));
+    res.local = true;
+  } else if(r_.kind[a] == reduce::Chain && r_.kind[b] == reduce::Chain
+            && r_.chain[a] == r_.chain[b]) {
+    auto s = r_.slot[a];
+    auto t = r_.slot[b];
+    auto along = s < t ? diff(forward_[t], forward_[s])
+                       : diff(backward_[s], backward_[t]);
+    res.cost = add(add(diff(up_[u], Prefix()), along), diff(down_[v], Prefix()));
+    res.local = true;
+  }
+
+  Portal pu[2], pv[2];
+  auto nu = portals(u, pu);
+  auto nv = portals(v, pv);
+  for(size_t i = 0; i < nu; i++) {
+    for(size_t j = 0; j < nv; j++) {
+      auto over = pu[i].core == pv[j].core ? 0 : dist_[pu[i].core][pv[j].core];
+      auto cost = add(add(pu[i].out, over), pv[j].in);
+      if(cost < res.cost) {
+        res = {cost, false, pu[i].core, pv[j].core, pu[i].end, pv[j].end};
+      }
     }
   }
-  return false;
+  return res;
+}
+
+// x and its ancestors up to and including top
+void Graph::appendUp(std::vector<size_t>& res, size_t x, size_t top) const {
+  while(x != top) {
+    res.push_back(x);
+    x = r_.parent[x];
+  }
+  res.push_back(top);
+}
+
+// the nodes below top down to x
+void Graph::appendDown(std::vector<size_t>& res, size_t x, size_t top) const {
+  auto begin = res.size();
+  while(x != top) {
+    res.push_back(x);
+    x = r_.parent[x];
+  }
+  std::reverse(res.begin() + static_cast<std::ptrdiff_t>(begin), res.end());
+}
+
+// chain nodes after slot from up to and including slot to
+void Graph::appendChain(std::vector<size_t>& res, size_t from, size_t to) const {
+  while(from != to) {
+    from = from < to ? from + 1 : from - 1;
+    res.push_back(r_.chainNodes[from]);
+  }
+}
+
+bool Graph::isPath(size_t u, size_t v) {
+  return route(u, v).cost != cInfinity;
+}
+
+bool Graph::isInPath(size_t u, size_t v, size_t x) {
+  auto p = path(u, v);
+  return std::find(p.begin() + (p.empty() ? 0 : 1), p.end(), x) != p.end();
 }
 
 std::vector<size_t> Graph::path(size_t u, size_t v) const {
   std::vector<size_t> res;
-  if(next_[u][v] == cInfinity) {
+  auto r = route(u, v);
+  if(r.cost == cInfinity) {
     return res;
   }
-  res.push_back(u);
-  while(u != v) {
-    u = next_[u][v];
+  if(u == v) {
     res.push_back(u);
+    return res;
   }
+  auto a = r_.anchor[u];
+  auto b = r_.anchor[v];
+  if(r.local && a == b) {
+    auto l = lca(u, v);
+    appendUp(res, u, l);
+    appendDown(res, v, l);
+    return res;
+  }
+  appendUp(res, u, a);
+  if(r.local) {
+    appendChain(res, r_.slot[a], r_.slot[b]);
+    appendDown(res, v, b);
+    return res;
+  }
+
+  auto chainEnd = [&](size_t x, uint32_t end) {
+    auto c = r_.chain[x];
+    return end == 0 ? r_.chainOffsets[c] : r_.chainOffsets[c + 1] - 1;
+  };
+  if(r_.kind[a] == reduce::Chain) {
+    appendChain(res, r_.slot[a], chainEnd(a, r.fromEnd));
+  }
+  size_t x = r.from;
+  while(x != r.to) {
+    size_t y = next_[x][r.to];
+    auto hop = superEdges_.find(uint64_t(x) << 32 | y);
+    if(hop != superEdges_.end()) {
+      auto c = hop->second / 2;
+      auto first = r_.chainOffsets[c];
+      auto last = r_.chainOffsets[c + 1] - 1;
+      if(hop->second % 2 == 0) {
+        appendChain(res, first, last);
+      } else {
+        appendChain(res, last, first);
+      }
+    } else {
+      res.push_back(r_.core[y]);
+    }
+    x = y;
+  }
+  if(r_.kind[b] == reduce::Chain) {
+    appendChain(res, chainEnd(b, r.toEnd), r_.slot[b]);
+  }
+  appendDown(res, v, b);
   return res;
 }
 
@@ -92,13 +324,24 @@ std::pair<int, std::vector<int>> Graph::centrality() const {
 }
 
 int64_t Graph::cost(size_t u, size_t v) const {
-  return dist_[u][v];
+  return route(u, v).cost;
 }
 
 int64_t Graph::maxCost() const {
   int64_t res = 0;
-  for(auto& d : dist_) {
-    for(auto c : d) {
+  if(K_ == V_) {
+    for(auto& d : dist_) {
+      for(auto c : d) {
+        if(c != cInfinity) {
+          res = std::max(c, res);
+        }
+      }
+    }
+    return res;
+  }
+  for(size_t i = 0; i < V_; i++) {
+    for(size_t j = 0; j < V_; j++) {
+      auto c = route(i, j).cost;
       if(c != cInfinity) {
         res = std::max(c, res);
       }
@@ -123,10 +366,10 @@ bool Graph::readCache() {
 
   if(t) {
     for(auto& d : dist_) {
-      t.read((char*)d.data(), V_ * sizeof(int64_t));
+      t.read((char*)d.data(), K_ * sizeof(int64_t));
     }
     for(auto& n : next_) {
-      t.read((char*)n.data(), V_ * sizeof(size_t));
+      t.read((char*)n.data(), K_ * sizeof(size_t));
     }
     return true;
   }
@@ -139,10 +382,10 @@ void Graph::writeCache() {
 
   if(t) {
     for(auto& d : dist_) {
-      t.write((char*)d.data(), V_ * sizeof(int64_t));
+      t.write((char*)d.data(), K_ * sizeof(int64_t));
     }
     for(auto& n : next_) {
-      t.write((char*)n.data(), V_ * sizeof(size_t));
+      t.write((char*)n.data(), K_ * sizeof(size_t));
     }
   }
 }
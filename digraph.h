@@ -8,6 +8,10 @@
 #include <string>
 #include <algorithm>
 #include <list>
+#include <unordered_map>
+
+#include "csr.h"
+#include "reduce.h"
 
 namespace digraph {
 
@@ -16,11 +20,20 @@ constexpr int64_t cInfinity = std::numeric_limits<int64_t>::max();
 class Graph
 {
 public:
-  Graph(size_t nNodes);
-
-  void addEdge(size_t u, size_t v, int64_t w, int64_t balance);
+  // g is the pair graph of aggregate::Pairs, one edge per node pair and
+  // direction. cost and capacity are indexed by its directed edge ids and
+  // carry the cheapest usable fee of the pair's channels (Pairs::cost)
+  // and its largest channel. edges that can't carry the amount passed to
+  // floydWarshall are ignored.
+  // with a reduction floydWarshall only runs on its core, the results for
+  // the other nodes are reconstructed when they are queried.
+  Graph(const csr::Graph& g,
+        const std::vector<int64_t>& cost,
+        const std::vector<int64_t>& capacity,
+        const reduce::Reduction* reduction = nullptr);
 
-  void floydWarshall(int64_t amount);
+  // cached: reuse/store the result in the cache directory
+  void floydWarshall(int64_t amount, bool cached = true);
 
   bool isPath(size_t u, size_t v);
   bool isInPath(size_t u, size_t v, size_t x);
@@ -31,11 +44,60 @@ public:
   int64_t maxCost() const;
 
 private:
+  // cost along a tree or chain, edges without a usable channel are
+  // counted instead of summed so that segments can be subtracted
+  struct Prefix {
+    int64_t cost = 0;
+    uint32_t missing = 0;
+  };
+
+  // cheapest way from u to v: inside their tree or chain (local) or
+  // leaving u's tree/chain at core node from and entering v's at to.
+  // fromEnd/toEnd tell which end of a chain is used.
+  struct Route {
+    int64_t cost = cInfinity;
+    bool local = false;
+    uint32_t from = reduce::cNone;
+    uint32_t to = reduce::cNone;
+    uint32_t fromEnd = 0;
+    uint32_t toEnd = 0;
+  };
+
+  // way out of (or into) the tree/chain of a node
+  struct Portal {
+    uint32_t core;  // core index
+    uint32_t end;   // 0: first, 1: last node of the chain
+    int64_t out;    // node -> core node
+    int64_t in;     // core node -> node
+  };
+
+  csr::Graph g_;
+  std::vector<int64_t> edgeCost_;
+  std::vector<int64_t> edgeCapacity_;
+  reduce::Reduction r_;
+
   size_t V_; // no of vertices
+  size_t K_; // no of core vertices
   size_t hash_;
-  std::vector<std::vector<int64_t>> dist_;
-  std::vector<std::vector<size_t>> next_;
-  std::vector<std::vector<int64_t>> cap_;
+  std::vector<std::vector<int64_t>> dist_; // core only
+  std::vector<std::vector<size_t>> next_;  // core only
+
+  std::vector<Prefix> up_;       // tree node to its anchor
+  std::vector<Prefix> down_;     // anchor to tree node
+  std::vector<Prefix> forward_;  // first node of the chain to slot
+  std::vector<Prefix> backward_; // slot to the first node of the chain
+  // core hops over a chain: (from << 32 | to) -> 2 * chain + reversed
+  std::unordered_map<uint64_t, uint32_t> superEdges_;
+
+  void prepare(int64_t amount);
+  int64_t edge(size_t u, size_t v, int64_t amount) const;
+
+  size_t portals(size_t x, Portal* res) const;
+  Route route(size_t u, size_t v) const;
+  size_t lca(size_t u, size_t v) const;
+  void appendUp(std::vector<size_t>& res, size_t x, size_t top) const;
+  void appendDown(std::vector<size_t>& res, size_t x, size_t top) const;
+  void appendChain(std::vector<size_t>& res, size_t from, size_t to) const;
 
   static std::size_t hash(std::vector<std::vector<int64_t>> const& vec,
                           int64_t seed);
@@ -0,0 +1,100 @@
+#include "dobfs.h"
+
+namespace dobfs {
+
+size_t Bfs::run(size_t start) {
+  auto& g = *g_;
+  auto nodes = g.nodeCount();
+  if(distance_.size() != nodes) {
+    distance_.assign(nodes, cUnreached);
+    frontier_.assign((nodes + 63) / 64, 0);
+    queue_.reserve(nodes);
+  }
+  for(auto u : queue_) {
+    distance_[u] = cUnreached;
+  }
+  queue_.clear();
+  unvisited_.clear();
+
+  distance_[start] = 0;
+  queue_.push_back(static_cast<uint32_t>(start));
+  // edges to check from the frontier and from the unvisited nodes
+  size_t frontierEdges = g.degree(start);
+  size_t unvisitedEdges = g.edgeCount() - frontierEdges;
+  bool bottom = false;
+
+  size_t first = 0;
+  for(uint32_t d = 0; first < queue_.size(); d++) {
+    size_t last = queue_.size();
+    size_t frontierNodes = last - first;
+    if(!bottom && frontierEdges > unvisitedEdges / cAlpha) {
+      bottom = true;
+      if(unvisited_.empty()) {
+        for(size_t v = 0; v < nodes; v++) {
+          if(distance_[v] == cUnreached) {
+            unvisited_.push_back(static_cast<uint32_t>(v));
+          }
+        }
+      }
+    } else if(bottom && frontierNodes < nodes / cBeta) {
+      bottom = false;
+    }
+
+    if(bottom) {
+      bottomUp(first, last, d);
+    } else {
+      topDown(first, last, d);
+    }
+
+    frontierEdges = 0;
+    for(size_t i = last; i < queue_.size(); i++) {
+      frontierEdges += g.degree(queue_[i]);
+    }
+    unvisitedEdges -= frontierEdges;
+    first = last;
+  }
+  return distance_[queue_.back()];
+}
+
+// nodes at distance d are queue_[first] .. queue_[last - 1]
+void Bfs::topDown(size_t first, size_t last, uint32_t d) {
+  for(size_t i = first; i < last; i++) {
+    for(auto v : g_->neighbours(queue_[i])) {
+      if(distance_[v] == cUnreached) {
+        distance_[v] = d + 1;
+        queue_.push_back(v);
+      }
+    }
+  }
+}
+
+void Bfs::bottomUp(size_t first, size_t last, uint32_t d) {
+  for(size_t i = first; i < last; i++) {
+    frontier_[queue_[i] / 64] |= uint64_t(1) << (queue_[i] % 64);
+  }
+  // nodes that stay unvisited are kept in place
+  size_t kept = 0;
+  for(auto v : unvisited_) {
+    if(distance_[v] != cUnreached) {
+      continue;
+    }
+    bool found = false;
+    for(auto u : g_->neighbours(v)) {
+      if((frontier_[u / 64] >> (u % 64)) & 1) {
+        found = true;
+        break;
+      }
+    }
+    if(found) {
+      distance_[v] = d + 1;
+      queue_.push_back(v);
+    } else {
+      unvisited_[kept++] = v;
+    }
+  }
+  unvisited_.resize(kept);
+  for(size_t i = first; i < last; i++) {
+    frontier_[queue_[i] / 64] = 0;
+  }
+}
+}
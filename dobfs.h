@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "csr.h"
+
+// direction optimizing breadth first search (Beamer et al.).
+// small frontiers are expanded top down from the frontier nodes. once the
+// edges of the frontier outweigh the edges of the unvisited nodes, the
+// levels are built bottom up instead: every unvisited node looks for a
+// parent in a bitmap of the frontier and stops at the first one, which
+// skips most edges into already visited nodes on hub-heavy graphs.
+namespace dobfs {
+
+constexpr uint32_t cUnreached = UINT32_MAX;
+
+// one search at a time on g. the buffers are allocated on the first run()
+// and reused, keep one Bfs per thread.
+class Bfs
+{
+public:
+  explicit Bfs(const csr::Graph& g) : g_(&g) {}
+
+  // searches from start, returns the distance to the farthest node
+  size_t run(size_t start);
+
+  // hops from the last start, cUnreached for nodes it doesn't reach
+  uint32_t distance(size_t u) const { return distance_[u]; }
+  // nodes reached by the last run by ascending distance
+  const std::vector<uint32_t>& reached() const { return queue_; }
+
+private:
+  // switch to bottom up when the frontier has more than 1/cAlpha of the
+  // edges of the unvisited nodes, back to top down when it has less than
+  // 1/cBeta of the nodes
+  static constexpr size_t cAlpha = 14;
+  static constexpr size_t cBeta = 24;
+
+  void topDown(size_t first, size_t last, uint32_t d);
+  void bottomUp(size_t first, size_t last, uint32_t d);
+
+  const csr::Graph* g_;
+  std::vector<uint32_t> distance_;
+  std::vector<uint32_t> queue_;     // doubles as the frontiers of all levels
+  std::vector<uint64_t> frontier_;  // bitmap of the current bottom up frontier
+  std::vector<uint32_t> unvisited_; // candidates of bottom up, may hold visited nodes
+};
+}
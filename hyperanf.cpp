@@ -0,0 +1,169 @@
+#include "hyperanf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace hyperanf {
+
+namespace {
+
+// splitmix64 finaliser, spreads node numbers over all bits
+uint64_t hash(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+// number of leading zero bits, x != 0
+int leadingZeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(x);
+#else
+  int res = 0;
+  for(; !(x >> 63); x <<= 1) {
+    res++;
+  }
+  return res;
+#endif
+}
+
+// counter = union of counter and other, m is a multiple of 16
+void merge(uint8_t* counter, const uint8_t* other, size_t m) {
+#ifdef __SSE2__
+  for(size_t i = 0; i < m; i += 16) {
+    auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(counter + i));
+    auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(other + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(counter + i), _mm_max_epu8(a, b));
+  }
+#else
+  for(size_t i = 0; i < m; i++) {
+    counter[i] = std::max(counter[i], other[i]);
+  }
+#endif
+}
+
+// 2^-r for every register value
+struct PowersOfHalf {
+  double value[65];
+  PowersOfHalf() {
+    for(int r = 0; r < 65; r++) {
+      value[r] = std::ldexp(1., -r);
+    }
+  }
+};
+const PowersOfHalf cPowersOfHalf;
+
+// HyperLogLog estimate of the number of distinct nodes in a counter,
+// linear counting while it is small
+double estimate(const uint8_t* registers, size_t m) {
+  double sum = 0;
+  size_t zeros = 0;
+  for(size_t i = 0; i < m; i++) {
+    sum += cPowersOfHalf.value[registers[i]];
+    zeros += registers[i] == 0;
+  }
+  double alpha = m == 16 ? 0.673 : m == 32 ? 0.697 : m == 64 ? 0.709
+                                 : 0.7213 / (1. + 1.079 / static_cast<double>(m));
+  double res = alpha * static_cast<double>(m) * static_cast<double>(m) / sum;
+  if(res <= 2.5 * static_cast<double>(m) && zeros > 0) {
+    res = static_cast<double>(m)
+        * std::log(static_cast<double>(m) / static_cast<double>(zeros));
+  }
+  return res;
+}
+}
+
+Result run(const csr::Graph& g, unsigned log2Registers, size_t threads) {
+  if(log2Registers < cMinLog2Registers || log2Registers > cMaxLog2Registers) {
+    throw std::runtime_error("HyperANF registers must be 2^"
+                             + std::to_string(cMinLog2Registers) + " to 2^"
+                             + std::to_string(cMaxLog2Registers));
+  }
+  size_t m = size_t(1) << log2Registers;
+  auto nodes = g.nodeCount();
+
+  // the counters of node u are counters[u * m] .. counters[u * m + m - 1]
+  std::vector<uint8_t> counters(nodes * m, 0);
+  std::vector<uint8_t> next(nodes * m);
+  for(size_t u = 0; u < nodes; u++) {
+    auto h = hash(u);
+    auto rest = h << log2Registers;
+    auto rank = rest ? leadingZeros(rest) + 1
+                     : 64 - static_cast<int>(log2Registers) + 1;
+    counters[u * m + (h >> (64 - log2Registers))] = static_cast<uint8_t>(rank);
+  }
+
+  std::vector<double> estimates(nodes);
+  for(size_t u = 0; u < nodes; u++) {
+    estimates[u] = estimate(counters.data() + u * m, m);
+  }
+  Result res;
+  auto sum = [&]() {
+    double s = 0;
+    for(auto e : estimates) {
+      s += e;
+    }
+    return s;
+  };
+  // within 0 hops every node reaches just itself, no need to estimate
+  res.neighbourhood.push_back(static_cast<double>(nodes));
+
+  // a counter only has to merge the neighbours that changed, the others
+  // were merged before
+  std::vector<uint8_t> changed(nodes, 1), nextChanged(nodes);
+  while(true) {
+    parallel::forEach(nodes, threads, [&](size_t, size_t u) {
+      auto own = counters.data() + u * m;
+      auto merged = next.data() + u * m;
+      std::memcpy(merged, own, m);
+      for(auto v : g.neighbours(u)) {
+        if(changed[v]) {
+          merge(merged, counters.data() + v * m, m);
+        }
+      }
+      nextChanged[u] = std::memcmp(merged, own, m) != 0;
+      if(nextChanged[u]) {
+        estimates[u] = estimate(merged, m);
+      }
+    }, 64);
+
+    if(std::find(nextChanged.begin(), nextChanged.end(), 1) == nextChanged.end()) {
+      break;
+    }
+    // counters only grow, an estimate may not
+    res.neighbourhood.push_back(std::max(sum(), res.neighbourhood.back()));
+    std::swap(counters, next);
+    std::swap(changed, nextChanged);
+  }
+
+  auto& n = res.neighbourhood;
+  double pairs = n.back() - n[0];
+  if(pairs > 0) {
+    double hops = 0;
+    for(size_t t = 1; t < n.size(); t++) {
+      hops += static_cast<double>(t) * (n[t] - n[t - 1]);
+    }
+    res.averageDistance = hops / pairs;
+
+    double target = 0.9 * pairs;
+    size_t t = 1;
+    while(n[t] - n[0] < target) {
+      t++;
+    }
+    res.effectiveDiameter = static_cast<double>(t - 1)
+        + (target - (n[t - 1] - n[0])) / (n[t] - n[t - 1]);
+  }
+  res.relativeError = 1.04 / std::sqrt(static_cast<double>(m));
+  return res;
+}
+}
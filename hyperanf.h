@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "csr.h"
+
+// approximate neighbourhood function with HyperLogLog counters (HyperANF,
+// Boldi, Rosa and Vigna).
+// every node has a counter of the nodes within t hops. one iteration
+// merges the counters of the neighbours into each node, so iteration t
+// counts the nodes within t + 1 hops. it stops when no counter changes,
+// after diameter + 1 passes over the adjacency.
+namespace hyperanf {
+
+constexpr unsigned cMinLog2Registers = 4;
+constexpr unsigned cMaxLog2Registers = 16;
+
+struct Result {
+  // neighbourhood[t] = estimated ordered pairs of nodes (s, u) with u at
+  // most t hops from s, counting every node with itself. neighbourhood[0]
+  // is exact, the node count
+  std::vector<double> neighbourhood;
+  // mean hops between the distinct nodes that reach each other
+  double averageDistance = 0;
+  // hops within which 90% of those pairs are, interpolated
+  double effectiveDiameter = 0;
+  // relative standard deviation of the counters and of neighbourhood,
+  // 1.04 / sqrt(registers)
+  double relativeError = 0;
+};
+
+// 2^log2Registers registers of one byte per node and counter, the error
+// halves with every two more. runs on threads threads (0 = one per core).
+Result run(const csr::Graph& g, unsigned log2Registers, size_t threads = 1);
+}
@@ -0,0 +1,137 @@
+#include "ingest.h"
+
+#include <algorithm>
+
+#include "numeric.h"
+
+namespace ingest {
+
+void malformed(std::string& error, const std::string& field,
+               std::string_view value) {
+  if(error.empty()) {
+    error = field + " '" + std::string(value) + "'";
+  }
+}
+
+void parsePubKey(std::string_view text, PubKey& key,
+                 std::string& error, const std::string& field) {
+  if(!decodePubKey(text, key)) {
+    malformed(error, field, text);
+  }
+}
+
+void parseAmount(std::string_view text, int64_t& value,
+                 std::string& error, const std::string& field) {
+  if(!numeric::parseAmount(text, value)) {
+    malformed(error, field, text);
+  }
+}
+
+void parseChannelId(std::string_view text, uint64_t& id,
+                    std::string& error, const std::string& field) {
+  if(!numeric::parseUnsigned(text, id)) {
+    malformed(error, field, text);
+  }
+}
+
+void addNode(Graph& g, NodeRecord& node) {
+  if(!node.error.empty()) {
+    g.errors.push_back("node: malformed " + node.error);
+    return;
+  }
+  // the node may already exist if an edge referencing it came first
+  g.setName(g.node(node.id), node.name);
+}
+
+bool accepted(const EdgeRecord& edge, const Filter& filter) {
+  auto& p1 = edge.policy[0];
+  auto& p2 = edge.policy[1];
+  if(!p1.present && !p2.present) {
+    return false;
+  }
+  if((p1.present && p1.disabled) || (p2.present && p2.disabled)) {
+    return false;
+  }
+  if(filter.bidirectional && !(p1.present && p2.present)) {
+    return false;
+  }
+  if(edge.capacity < filter.minCapacity) {
+    return false;
+  }
+  if(filter.maxAge > 0) {
+    auto lastUpdate = std::max({edge.lastUpdate, p1.lastUpdate, p2.lastUpdate});
+    if(lastUpdate < filter.now - filter.maxAge) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void addEdge(Graph& g, EdgeRecord& edge, const Filter& filter) {
+  // before the filter, which would judge the fields that failed to parse
+  if(!edge.error.empty()) {
+    g.errors.push_back("channel " + std::to_string(edge.id)
+                       + ": malformed " + edge.error);
+    return;
+  }
+  if(!accepted(edge, filter)) {
+    return;
+  }
+
+  Channel n{};
+  n.policyA = edge.policy[0].present;
+  n.policyB = edge.policy[1].present;
+  n.feeA = edge.policy[0].fee;
+  n.feerateA = edge.policy[0].feerate;
+  n.feeB = edge.policy[1].fee;
+  n.feerateB = edge.policy[1].feerate;
+  n.id = edge.id;
+  n.nodeA = g.node(edge.nodeA);
+  n.nodeB = g.node(edge.nodeB);
+  n.capacity = edge.capacity;
+  g.channels.push_back(n);
+}
+
+void finish(Graph& g, const Filter& filter) {
+  // by short channel id, the first record of an id wins
+  auto byId = [](const Channel& a, const Channel& b) { return a.id < b.id; };
+  if(!std::is_sorted(g.channels.begin(), g.channels.end(), byId)) {
+    std::stable_sort(g.channels.begin(), g.channels.end(), byId);
+  }
+  g.channels.erase(std::unique(g.channels.begin(), g.channels.end(),
+                               [](const Channel& a, const Channel& b) {
+                                 return a.id == b.id;
+                               }),
+                   g.channels.end());
+
+  // totals over the channels that survived deduplication
+  for(auto& c : g.channels) {
+    g.capacity += c.capacity;
+    g.nodes[c.nodeA].channels++;
+    g.nodes[c.nodeB].channels++;
+  }
+
+  if(!filter.dropIsolated) {
+    return;
+  }
+
+  // keep the nodes with channels and number them densely
+  std::vector<uint32_t> number(g.nodes.size());
+  std::vector<Node> nodes;
+  NodeIndex index;
+  for(size_t n = 0; n < g.nodes.size(); n++) {
+    if(g.nodes[n].channels == 0) {
+      continue;
+    }
+    number[n] = static_cast<uint32_t>(nodes.size());
+    index.insert(g.pubKey(n));
+    nodes.push_back(g.nodes[n]);
+  }
+  for(auto& c : g.channels) {
+    c.nodeA = number[c.nodeA];
+    c.nodeB = number[c.nodeB];
+  }
+  g.nodes = std::move(nodes);
+  g.index = std::move(index);
+}
+}
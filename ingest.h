@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lnGraph.h"
+
+// records shared by the loaders of the different node implementations.
+// loaders fill records from their input format, addNode/addEdge apply
+// the common filtering and add them to the graph.
+namespace ingest {
+
+struct NodeRecord {
+  PubKey id;
+  std::string name;
+  std::string error; // first malformed field, empty if there is none
+};
+
+struct PolicyRecord {
+  bool present = false;
+  bool disabled = false;
+  int64_t fee = 0;
+  int64_t feerate = 0;
+  int64_t lastUpdate = 0; // unix time
+};
+
+struct EdgeRecord {
+  uint64_t id = 0; // short channel id
+  PubKey nodeA;
+  PubKey nodeB;
+  int64_t capacity = 0;
+  int64_t lastUpdate = 0; // unix time, if the format has one per channel
+  PolicyRecord policy[2]; // routing from nodeA, routing from nodeB
+  std::string error; // first malformed field, empty if there is none
+};
+
+// channels and nodes to leave out of the graph.
+// channel filters are checked per record while loading, so dropped
+// channels are never added to the graph.
+struct Filter {
+  int64_t minCapacity = 0; // satoshi
+  int64_t maxAge = 0;      // seconds since the last update, 0 = any
+  int64_t now = 0;         // unix time maxAge is relative to
+  bool bidirectional = false; // drop channels with only one policy
+  bool dropIsolated = false;  // drop nodes without channels (renumbers nodes)
+};
+
+// node and edge records in document order
+struct Records {
+  std::vector<NodeRecord> nodes;
+  std::vector<EdgeRecord> edges;
+};
+
+// notes field as the record's error unless it already has one
+void malformed(std::string& error, const std::string& field,
+               std::string_view value);
+void parsePubKey(std::string_view text, PubKey& key,
+                 std::string& error, const std::string& field);
+void parseAmount(std::string_view text, int64_t& value,
+                 std::string& error, const std::string& field);
+// channel id as 64 bit decimal
+void parseChannelId(std::string_view text, uint64_t& id,
+                    std::string& error, const std::string& field);
+
+// malformed records end up in g.errors
+void addNode(Graph& g, NodeRecord& node);
+// false for edges that don't go into the graph: without any policy,
+// with a disabled one, or excluded by the filter
+bool accepted(const EdgeRecord& edge, const Filter& filter);
+// reports the edge if it is malformed, else adds it if it is accepted
+void addEdge(Graph& g, EdgeRecord& edge, const Filter& filter);
+// drops duplicate channels, counts capacity and channels per node and
+// applies the node filters once all records are added
+void finish(Graph& g, const Filter& filter);
+}
@@ -0,0 +1,151 @@
+#include "inputBuffer.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "decompress.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+InputBuffer::InputBuffer(const std::string& path, bool raw, Access access)
+{
+  if(path == "-" || !map(path, access)) {
+    read(path);
+  }
+
+  auto format = decompress::detect(data_, size_);
+  if(!raw && format != decompress::Format::None) {
+    // the destructor doesn't run when the constructor throws
+    std::vector<char> content;
+    try {
+      content = decompress::all(data_, size_, format);
+    } catch(...) {
+      unmap();
+      throw;
+    }
+    unmap();
+    buffer_ = std::move(content);
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+  }
+}
+
+InputBuffer::~InputBuffer()
+{
+  unmap();
+}
+
+void InputBuffer::unmap()
+{
+#ifdef _WIN32
+  if(map_) {
+    UnmapViewOfFile(map_);
+  }
+  if(mapping_) {
+    CloseHandle(mapping_);
+  }
+  mapping_ = nullptr;
+#else
+  if(map_) {
+    munmap(map_, size_);
+  }
+#endif
+  map_ = nullptr;
+}
+
+#ifdef _WIN32
+bool InputBuffer::map(const std::string& path, Access access)
+{
+  DWORD flags = access == Access::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN
+                                             : FILE_ATTRIBUTE_NORMAL;
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, flags, nullptr);
+  if(file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if(GetFileType(file) != FILE_TYPE_DISK
+     || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+  mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if(!mapping_) {
+    return false;
+  }
+  map_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+  if(!map_) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+    return false;
+  }
+  data_ = static_cast<const char*>(map_);
+  size_ = static_cast<size_t>(fileSize.QuadPart);
+  return true;
+}
+#else
+bool InputBuffer::map(const std::string& path, Access access)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(p == MAP_FAILED) {
+    return false;
+  }
+  madvise(p, size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+  map_ = p;
+  data_ = static_cast<const char*>(p);
+  size_ = size;
+  return true;
+}
+#endif
+
+void InputBuffer::read(const std::string& path)
+{
+  std::FILE* f = path == "-" ? stdin : std::fopen(path.c_str(), "rb");
+  if(!f) {
+    throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+  }
+
+  constexpr size_t cChunk = 1 << 20;
+  size_t used = 0;
+  while(true) {
+    buffer_.resize(used + cChunk);
+    auto n = std::fread(buffer_.data() + used, 1, cChunk, f);
+    used += n;
+    if(n < cChunk) {
+      break;
+    }
+  }
+  bool failed = std::ferror(f) != 0;
+  if(f != stdin) {
+    std::fclose(f);
+  }
+  if(failed) {
+    throw std::runtime_error("error reading " + path);
+  }
+
+  buffer_.resize(used);
+  data_ = buffer_.data();
+  size_ = used;
+}
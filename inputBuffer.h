@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// read-only, contiguous view of an input file.
+// regular files are memory mapped, so no copy of the content is made.
+// pipes, stdin ("-") and anything that can't be mapped fall back to
+// buffered reads into a heap buffer.
+// gzip or zstd compressed files are decompressed into memory, unless raw
+// is set (for readers that decompress on the fly).
+class InputBuffer
+{
+public:
+  // how the mapped content is read, a hint for the kernel's readahead:
+  // parsers walk the input front to back once, snapshots are read section
+  // by section and looked up at random.
+  enum class Access { Sequential, Normal };
+
+  explicit InputBuffer(const std::string& path, bool raw = false,
+                       Access access = Access::Sequential);
+  ~InputBuffer();
+
+  InputBuffer(const InputBuffer&) = delete;
+  InputBuffer& operator=(const InputBuffer&) = delete;
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+
+  bool mapped() const { return map_ != nullptr; }
+
+private:
+  bool map(const std::string& path, Access access);
+  void unmap();
+  void read(const std::string& path);
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  void* map_ = nullptr;
+#ifdef _WIN32
+  void* mapping_ = nullptr;
+#endif
+  std::vector<char> buffer_;
+};
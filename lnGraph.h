@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "nodeIndex.h"
+#include "stringPool.h"
+
+// nodes and channels are stored by value in contiguous arrays and refer
+// to each other by number, aliases live in one string pool.
+
+struct Node {
+  uint32_t name = 0;     // alias, number in Graph::names
+  uint32_t channels = 0; // number of channels, counted by ingest::finish
+};
+
+struct Channel {
+  uint64_t id;      // short channel id
+  uint32_t nodeA;   // node number
+  uint32_t nodeB;   // node number
+  int64_t capacity; // satoshi
+  int64_t feeA;     // fee routing from node A, millisatoshi
+  int64_t feerateA; // feerate routing from node A, one millionth
+  int64_t feeB;     // fee routing from node B, millisatoshi
+  int64_t feerateB; // feerate routing from node B, one millionth
+  bool policyA;     // node A announced a policy, else feeA/feerateA are unset
+  bool policyB;     // node B announced a policy, else feeB/feerateB are unset
+
+  // fields of the short channel id: the funding transaction's block,
+  // its position in the block and the funding output
+  uint32_t blockHeight() const { return static_cast<uint32_t>(id >> 40); }
+  uint32_t txIndex() const { return static_cast<uint32_t>(id >> 16) & 0xffffff; }
+  uint16_t outputIndex() const { return static_cast<uint16_t>(id); }
+};
+
+struct Graph {
+  std::vector<Node> nodes;       // indexed by node number
+  NodeIndex index;               // pub_key -> node number
+  StringPool names;              // aliases, 0 is the empty alias
+  // in insertion order while loading, ingest::finish sorts them by short
+  // channel id and drops duplicates
+  std::vector<Channel> channels;
+  int64_t capacity = 0; // satoshi, summed by ingest::finish
+  std::vector<std::string> errors; // malformed records skipped while loading
+
+  Graph() { names.add(""); }
+
+  // number of the node with the given pub_key.
+  // unknown keys get a new node without alias.
+  uint32_t node(const PubKey& key) {
+    auto res = index.insert(key);
+    if(res.second) {
+      nodes.emplace_back();
+    }
+    return static_cast<uint32_t>(res.first);
+  }
+
+  const PubKey& pubKey(size_t n) const { return index.key(n); }
+  std::string_view name(size_t n) const { return names.get(nodes[n].name); }
+  void setName(size_t n, std::string_view name) {
+    nodes[n].name = name.empty() ? 0 : names.add(name);
+  }
+
+  void reserve(size_t nodeCount, size_t channelCount) {
+    nodes.reserve(nodeCount);
+    index.reserve(nodeCount);
+    channels.reserve(channelCount);
+  }
+};
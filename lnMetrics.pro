@@ -1,5 +1,5 @@
 TEMPLATE = app
-CONFIG += console c++17
+CONFIG += console c++17 thread
 CONFIG -= app_bundle
 CONFIG -= qt
 
@@ -7,11 +7,61 @@ INCLUDEPATH += json/include
 
 SOURCES += \
         main.cpp \
-    digraph.cpp
+    aggregate.cpp \
+    bounds.cpp \
+    clnLoader.cpp \
+    csr.cpp \
+    decompress.cpp \
+    digraph.cpp \
+    dobfs.cpp \
+    hyperanf.cpp \
+    ingest.cpp \
+    inputBuffer.cpp \
+    loader.cpp \
+    msbfs.cpp \
+    nodeIndex.cpp \
+    policy.cpp \
+    reduce.cpp \
+    reorder.cpp \
+    snapshot.cpp
 
 HEADERS += \
+    aggregate.h \
     apGraph.h \
-    digraph.h
+    bounds.h \
+    csr.h \
+    decompress.h \
+    digraph.h \
+    dobfs.h \
+    hyperanf.h \
+    ingest.h \
+    inputBuffer.h \
+    lnGraph.h \
+    loader.h \
+    msbfs.h \
+    nodeIndex.h \
+    numeric.h \
+    parallel.h \
+    policy.h \
+    profile.h \
+    reduce.h \
+    reorder.h \
+    snapshot.h \
+    stringPool.h
+
+win32: LIBS += -lpsapi
+
+# optional decompression of gzip/zstd archived dumps
+packagesExist(zlib) {
+  DEFINES += HAVE_ZLIB
+  CONFIG += link_pkgconfig
+  PKGCONFIG += zlib
+}
+packagesExist(libzstd) {
+  DEFINES += HAVE_ZSTD
+  CONFIG += link_pkgconfig
+  PKGCONFIG += libzstd
+}
 
 # Enable C++17 manually, since CONFIG += c++17/1z doesn't work yet with MSVC
 # See also QTBUG-63527
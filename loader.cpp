@@ -0,0 +1,555 @@
+#include "loader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+#include "decompress.h"
+#include "ingest.h"
+#include "inputBuffer.h"
+#include "parallel.h"
+
+using json = nlohmann::json;
+using namespace ingest;
+
+namespace {
+
+// DOM access helpers. missing fields are left at their defaults.
+
+std::string_view text(const json& o, const char* key) {
+  auto it = o.find(key);
+  if(it == o.end() || !it->is_string()) {
+    return {};
+  }
+  return it->get_ref<const std::string&>();
+}
+
+void amount(const json& o, const char* key, int64_t& value, std::string& error) {
+  auto it = o.find(key);
+  if(it == o.end() || it->is_null()) {
+    return;
+  }
+  if(it->is_number_unsigned()) {
+    auto v = it->get<uint64_t>();
+    if(v > static_cast<uint64_t>(INT64_MAX)) {
+      malformed(error, key, std::to_string(v));
+    } else {
+      value = static_cast<int64_t>(v);
+    }
+  } else if(it->is_string()) {
+    parseAmount(it->get_ref<const std::string&>(), value, error, key);
+  } else {
+    malformed(error, key, it->dump());
+  }
+}
+
+void channelId(const json& o, const char* key, uint64_t& id, std::string& error) {
+  auto it = o.find(key);
+  if(it != o.end() && it->is_number_unsigned()) {
+    id = it->get<uint64_t>();
+  } else if(it != o.end() && it->is_string()) {
+    parseChannelId(it->get_ref<const std::string&>(), id, error, key);
+  } else {
+    malformed(error, key, it == o.end() ? "" : it->dump());
+  }
+}
+
+void policy(const json& edge, const char* key, PolicyRecord& p, std::string& error) {
+  auto it = edge.find(key);
+  if(it == edge.end() || !it->is_object()) {
+    return;
+  }
+  p.present = true;
+  auto disabled = it->find("disabled");
+  p.disabled = disabled != it->end() && disabled->is_boolean()
+               && disabled->get<bool>();
+  amount(*it, "fee_base_msat", p.fee, error);
+  amount(*it, "fee_rate_milli_msat", p.feerate, error);
+  amount(*it, "last_update", p.lastUpdate, error);
+}
+}
+
+Graph graphFromJson(const std::string& file, const Filter& filter) {
+  InputBuffer in(file);
+  auto raw = json::parse(in.begin(), in.end());
+
+  Graph g;
+
+  auto nodes = raw.find("nodes");
+  auto edges = raw.find("edges");
+  g.reserve(nodes != raw.end() ? nodes->size() : 0,
+            edges != raw.end() ? edges->size() : 0);
+  if(nodes != raw.end()) {
+    for(auto& node : *nodes) {
+      NodeRecord n;
+      parsePubKey(text(node, "pub_key"), n.id, n.error, "pub_key");
+      n.name = text(node, "alias");
+      addNode(g, n);
+    }
+  }
+
+  if(edges != raw.end()) {
+    for(auto& edge : *edges) {
+      EdgeRecord e;
+      policy(edge, "node1_policy", e.policy[0], e.error);
+      policy(edge, "node2_policy", e.policy[1], e.error);
+      channelId(edge, "channel_id", e.id, e.error);
+      parsePubKey(text(edge, "node1_pub"), e.nodeA, e.error, "node1_pub");
+      parsePubKey(text(edge, "node2_pub"), e.nodeB, e.error, "node2_pub");
+      amount(edge, "capacity", e.capacity, e.error);
+      amount(edge, "last_update", e.lastUpdate, e.error);
+      addEdge(g, e, filter);
+    }
+  }
+
+  finish(g, filter);
+  return g;
+}
+
+namespace {
+
+enum class Section { None, Nodes, Edges };
+
+// SAX consumer for the describegraph document.
+// container depth: 1 = root object, 2 = "nodes"/"edges" array,
+// 3 = node/edge record, 4 = policy object (or some nested value we skip).
+class DescribeGraphSax : public json::json_sax_t
+{
+public:
+  // consumes a whole document and adds the records to the graph
+  DescribeGraphSax(Graph& g, const Filter& filter) :
+    g_(&g)
+  , filter_(filter)
+  {
+  }
+
+  // consumes single elements of the nodes or edges array
+  // and collects the accepted ones in out
+  DescribeGraphSax(Section section, Records& out, const Filter& filter) :
+    filter_(filter)
+  , depth_(2)
+  , section_(section)
+  , out_(&out)
+  {
+  }
+
+  bool null() override {
+    if(depth_ == 3 && section_ == Section::Edges) {
+      // "node1_policy": null
+      if(key_ == "node1_policy") {
+        edge_.policy[0].present = false;
+      } else if(key_ == "node2_policy") {
+        edge_.policy[1].present = false;
+      }
+    }
+    return true;
+  }
+
+  bool boolean(bool val) override {
+    if(depth_ == 4 && policy_ && key_ == "disabled") {
+      policy_->disabled = val;
+    }
+    return true;
+  }
+
+  bool number_integer(number_integer_t val) override {
+    if(auto field = amountField()) {
+      if(val < 0) {
+        malformed(edge_.error, key_, std::to_string(val));
+      } else {
+        *field = val;
+      }
+      return true;
+    }
+    return value(std::to_string(val));
+  }
+
+  bool number_unsigned(number_unsigned_t val) override {
+    if(isChannelId()) {
+      seen_.channelId = true;
+      edge_.id = val;
+      return true;
+    }
+    if(auto field = amountField()) {
+      if(val > static_cast<number_unsigned_t>(INT64_MAX)) {
+        malformed(edge_.error, key_, std::to_string(val));
+      } else {
+        *field = static_cast<int64_t>(val);
+      }
+      return true;
+    }
+    return value(std::to_string(val));
+  }
+
+  bool number_float(number_float_t, const string_t& val) override {
+    if(isChannelId()) {
+      seen_.channelId = true;
+      malformed(edge_.error, key_, val);
+    } else if(amountField()) {
+      malformed(edge_.error, key_, val);
+    }
+    return true;
+  }
+
+  bool string(string_t& val) override {
+    return value(val);
+  }
+
+  bool start_object(std::size_t) override {
+    depth_++;
+    if(depth_ == 3) {
+      node_ = NodeRecord{};
+      edge_ = EdgeRecord{};
+      seen_ = Seen{};
+    } else if(depth_ == 4 && section_ == Section::Edges) {
+      if(key_ == "node1_policy") {
+        policy_ = &edge_.policy[0];
+      } else if(key_ == "node2_policy") {
+        policy_ = &edge_.policy[1];
+      }
+      if(policy_) {
+        *policy_ = PolicyRecord{};
+        policy_->present = true;
+      }
+    }
+    return true;
+  }
+
+  bool key(string_t& val) override {
+    if(depth_ <= 4) {
+      key_.swap(val);
+    }
+    return true;
+  }
+
+  bool end_object() override {
+    if(depth_ == 4) {
+      policy_ = nullptr;
+    } else if(depth_ == 3) {
+      // like the DOM loader, a missing key is malformed
+      if(section_ == Section::Nodes) {
+        if(!seen_.pubKey) {
+          malformed(node_.error, "pub_key", "");
+        }
+        if(out_) {
+          out_->nodes.push_back(std::move(node_));
+        } else {
+          addNode(*g_, node_);
+        }
+      } else if(section_ == Section::Edges) {
+        if(!seen_.channelId) {
+          malformed(edge_.error, "channel_id", "");
+        }
+        if(!seen_.node1) {
+          malformed(edge_.error, "node1_pub", "");
+        }
+        if(!seen_.node2) {
+          malformed(edge_.error, "node2_pub", "");
+        }
+        if(out_) {
+          // malformed records are kept to be reported by addEdge
+          if(!edge_.error.empty() || accepted(edge_, filter_)) {
+            out_->edges.push_back(std::move(edge_));
+          }
+        } else {
+          addEdge(*g_, edge_, filter_);
+        }
+      }
+    }
+    depth_--;
+    return true;
+  }
+
+  bool start_array(std::size_t) override {
+    depth_++;
+    if(depth_ == 2) {
+      if(key_ == "nodes") {
+        section_ = Section::Nodes;
+      } else if(key_ == "edges") {
+        section_ = Section::Edges;
+      }
+    }
+    return true;
+  }
+
+  bool end_array() override {
+    if(depth_ == 2) {
+      section_ = Section::None;
+    }
+    depth_--;
+    return true;
+  }
+
+  bool parse_error(std::size_t position,
+                   const std::string& lastToken,
+                   const nlohmann::detail::exception& ex) override {
+    throw std::runtime_error("parse error at byte " + std::to_string(position)
+                             + " near '" + lastToken + "': " + ex.what());
+  }
+
+private:
+  bool isChannelId() const {
+    return depth_ == 3 && section_ == Section::Edges && key_ == "channel_id";
+  }
+
+  // the numeric field the current key refers to, if any
+  int64_t* amountField() {
+    if(depth_ == 3 && section_ == Section::Edges) {
+      if(key_ == "capacity") {
+        return &edge_.capacity;
+      } else if(key_ == "last_update") {
+        return &edge_.lastUpdate;
+      }
+    }
+    if(depth_ == 4 && policy_) {
+      if(key_ == "fee_base_msat") {
+        return &policy_->fee;
+      } else if(key_ == "fee_rate_milli_msat") {
+        return &policy_->feerate;
+      } else if(key_ == "last_update") {
+        return &policy_->lastUpdate;
+      }
+    }
+    return nullptr;
+  }
+
+  bool value(string_t& val) {
+    if(auto field = amountField()) {
+      // parsed in place from the lexer's token, no copy
+      parseAmount(val, *field, edge_.error, key_);
+    } else if(depth_ == 3) {
+      if(section_ == Section::Nodes) {
+        if(key_ == "pub_key") {
+          seen_.pubKey = true;
+          parsePubKey(val, node_.id, node_.error, key_);
+        } else if(key_ == "alias") {
+          node_.name.swap(val);
+        }
+      } else if(section_ == Section::Edges) {
+        if(isChannelId()) {
+          seen_.channelId = true;
+          parseChannelId(val, edge_.id, edge_.error, key_);
+        } else if(key_ == "node1_pub") {
+          seen_.node1 = true;
+          parsePubKey(val, edge_.nodeA, edge_.error, key_);
+        } else if(key_ == "node2_pub") {
+          seen_.node2 = true;
+          parsePubKey(val, edge_.nodeB, edge_.error, key_);
+        }
+      }
+    }
+    return true;
+  }
+
+  bool value(string_t&& val) {
+    return value(val);
+  }
+
+  Graph* g_ = nullptr;
+  const Filter& filter_;
+  int depth_ = 0;
+  Section section_ = Section::None;
+  std::string key_;
+
+  // required fields of the current record that were seen
+  struct Seen {
+    bool pubKey = false;
+    bool channelId = false;
+    bool node1 = false;
+    bool node2 = false;
+  };
+
+  NodeRecord node_;
+  EdgeRecord edge_;
+  Seen seen_;
+  PolicyRecord* policy_ = nullptr;
+  Records* out_ = nullptr;
+};
+
+// byte range of one element of the nodes or edges array
+struct Span {
+  const char* begin;
+  const char* end;
+};
+
+const char* skipWhitespace(const char* p, const char* end) {
+  while(p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+    p++;
+  }
+  return p;
+}
+
+// p points to the opening quote, returns the position after the closing one
+const char* skipString(const char* p, const char* end) {
+  for(p++; p < end; p++) {
+    if(*p == '\\') {
+      p++;
+    } else if(*p == '"') {
+      return p + 1;
+    }
+  }
+  throw std::runtime_error("unterminated string in json");
+}
+
+// returns the position after the json value starting at p.
+// only tracks strings and nesting, the value itself is checked by the
+// parser later.
+const char* skipValue(const char* p, const char* end) {
+  if(p < end && *p == '"') {
+    return skipString(p, end);
+  }
+  if(p < end && *p != '{' && *p != '[') {
+    while(p < end && *p != ',' && *p != '}' && *p != ']'
+          && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') {
+      p++;
+    }
+    return p;
+  }
+  int depth = 0;
+  while(p < end) {
+    switch(*p) {
+    case '"':
+      p = skipString(p, end);
+      continue;
+    case '{':
+    case '[':
+      depth++;
+      break;
+    case '}':
+    case ']':
+      if(--depth == 0) {
+        return p + 1;
+      }
+      break;
+    }
+    p++;
+  }
+  throw std::runtime_error("unexpected end of json");
+}
+
+const char* expect(const char* p, const char* end, char c) {
+  if(p >= end || *p != c) {
+    throw std::runtime_error(std::string("malformed json, expected '") + c + "'");
+  }
+  return p + 1;
+}
+
+// splits the elements of the top level "nodes" and "edges" arrays
+// at their boundaries without parsing them
+void splitRecords(const char* p, const char* end,
+                  std::vector<Span>& nodes, std::vector<Span>& edges) {
+  p = expect(skipWhitespace(p, end), end, '{');
+  while(true) {
+    p = skipWhitespace(p, end);
+    if(p < end && *p == '}') {
+      return;
+    }
+    auto keyBegin = p + 1;
+    p = skipString(expect(p, end, '"') - 1, end);
+    std::string key(keyBegin, p - 1);
+    p = skipWhitespace(expect(skipWhitespace(p, end), end, ':'), end);
+
+    std::vector<Span>* records = nullptr;
+    if(key == "nodes") {
+      records = &nodes;
+    } else if(key == "edges") {
+      records = &edges;
+    }
+    if(records && p < end && *p == '[') {
+      p = skipWhitespace(p + 1, end);
+      while(p < end && *p != ']') {
+        auto begin = p;
+        p = skipValue(p, end);
+        records->push_back({begin, p});
+        p = skipWhitespace(p, end);
+        if(p < end && *p == ',') {
+          p = skipWhitespace(p + 1, end);
+        }
+      }
+      p = expect(p, end, ']');
+    } else {
+      p = skipValue(p, end);
+    }
+
+    p = skipWhitespace(p, end);
+    if(p < end && *p == ',') {
+      p++;
+    }
+  }
+}
+
+// parses the records on the thread pool of parallel::forEach. each index
+// is a chunk of consecutive records, so every chunk's result stays in
+// document order.
+std::vector<Records> parseRecords(Section section,
+                                  const std::vector<Span>& records,
+                                  size_t threads, const Filter& filter) {
+  size_t chunkCount = std::min(records.size(), threads * 8);
+  std::vector<Records> chunks(chunkCount);
+  parallel::forEach(chunkCount, threads, [&](size_t, size_t c) {
+    size_t begin = records.size() * c / chunkCount;
+    size_t end = records.size() * (c + 1) / chunkCount;
+    DescribeGraphSax sax(section, chunks[c], filter);
+    for(size_t r = begin; r < end; r++) {
+      json::sax_parse(records[r].begin, records[r].end, &sax);
+    }
+  });
+  return chunks;
+}
+}
+
+Graph graphFromJsonSax(const std::string& file, const Filter& filter) {
+  InputBuffer in(file, true);
+
+  Graph g;
+  DescribeGraphSax sax(g, filter);
+  auto format = decompress::detect(in.data(), in.size());
+  if(format == decompress::Format::None) {
+    json::sax_parse(in.begin(), in.end(), &sax);
+  } else {
+    // decompress on a second thread while parsing
+    decompress::Streambuf buf(in.data(), in.size(), format);
+    std::istream stream(&buf);
+    try {
+      json::sax_parse(stream, &sax);
+    } catch(...) {
+      // a decompression error shows up as truncated json, report it instead
+      buf.rethrow();
+      throw;
+    }
+    buf.rethrow();
+  }
+  finish(g, filter);
+  return g;
+}
+
+Graph graphFromJsonParallel(const std::string& file, size_t threads,
+                            const Filter& filter) {
+  InputBuffer in(file);
+  threads = parallel::threadCount(threads);
+
+  std::vector<Span> nodeSpans, edgeSpans;
+  splitRecords(in.begin(), in.end(), nodeSpans, edgeSpans);
+
+  auto nodes = parseRecords(Section::Nodes, nodeSpans, threads, filter);
+  auto edges = parseRecords(Section::Edges, edgeSpans, threads, filter);
+
+  // merging in chunk order gives the same graph as the sequential loaders
+  Graph g;
+  g.reserve(nodeSpans.size(), edgeSpans.size());
+  for(auto& chunk : nodes) {
+    for(auto& node : chunk.nodes) {
+      addNode(g, node);
+    }
+  }
+  for(auto& chunk : edges) {
+    for(auto& edge : chunk.edges) {
+      addEdge(g, edge, filter);
+    }
+  }
+  finish(g, filter);
+  return g;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+#include "ingest.h"
+#include "lnGraph.h"
+
+// all loaders drop the channels and nodes excluded by filter.
+
+// builds the graph from lnd's describegraph json output.
+// parses the whole document into a json DOM first.
+// file is read through InputBuffer, "-" reads from stdin.
+// gzip and zstd compressed files are recognised by their magic bytes.
+Graph graphFromJson(const std::string& file,
+                    const ingest::Filter& filter = {});
+
+// same result as graphFromJson, but nodes and channels are filled in
+// directly from the SAX events while the file is read. no DOM is built.
+// compressed files are decompressed on a second thread while parsing.
+Graph graphFromJsonSax(const std::string& file,
+                       const ingest::Filter& filter = {});
+
+// same result as graphFromJson. the top level arrays are only split at
+// their element boundaries, the elements are then parsed on a pool of
+// threads (0 = one per core) and merged in document order.
+Graph graphFromJsonParallel(const std::string& file, size_t threads = 0,
+                            const ingest::Filter& filter = {});
+
+// builds the graph from core lightning's listchannels output and
+// (optionally, for the aliases) its listnodes output.
+// listchannels has one record per direction, both are merged into one
+// Channel with the same conventions as lnd: node A is the lesser pub_key,
+// the channel id is the short channel id as 64 bit decimal.
+Graph graphFromCln(const std::string& channelsFile,
+                   const std::string& nodesFile = "",
+                   const ingest::Filter& filter = {});
@@ -1,14 +1,23 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <map>
+#include <cmath>
+#include <ctime>
+#include <exception>
 
-#include <nlohmann/json.hpp>
-
+#include "aggregate.h"
 #include "apGraph.h"
 #include "digraph.h"
+#include "loader.h"
+#include "parallel.h"
+#include "policy.h"
+#include "profile.h"
+#include "reorder.h"
+#include "snapshot.h"
 
 using namespace std;
-using json = nlohmann::json;
+using snapshot::Snapshot;
 
 constexpr int64_t cTtransferAmount = 10000000; // milli satoshi (10ksat)
 
@@ -24,174 +33,62 @@ auto end (reversion_wrapper<T> w) { return std::rend(w.iterable); }
 template <typename T>
 reversion_wrapper<T> reverse (T&& iterable) { return { iterable }; }
 
-struct Channel;
-
-struct Node {
-  size_t number;
-  string id;
-  string name;
-  std::vector<Channel*> channels;
-
-  //dijkstra
-  std::map<Node*, int> distance;
-};
-
-struct Channel {
-  string id;
-  Node* nodeA;
-  Node* nodeB;
-  int64_t capacity; // satoshi
-  int64_t feeA;     // fee routing from node A, millisatoshi
-  int64_t feerateA; // feerate routing from node A, one millionth
-  int64_t feeB;     // fee routing from node B, millisatoshi
-  int64_t feerateB; // feerate routing from node B, one millionth
-};
-
-struct Graph {
-  std::map<string, Node> nodes;
-  std::map<string, Channel> channels;
-  std::vector<Node*> nodeVect;
-  int64_t capacity;
-};
-
-Graph graphFromJson(string file) {
-  std::ifstream t(file);
-  std::string str((std::istreambuf_iterator<char>(t)),
-                   std::istreambuf_iterator<char>());
-
-  auto raw = json::parse(str);
-
-  Graph g;
-  int64_t capacity{};
-
-  if(raw.find("nodes") != raw.end()) {
-    auto nodes = raw["nodes"];
-    size_t number = 0;
-    for(auto& node : nodes) {
-      Node n;
-      n.number = number++;
-      n.id = node["pub_key"].get<std::string>();
-      n.name = node["alias"].get<std::string>();
-      auto nres = g.nodes.insert({n.id, n});
-      g.nodeVect.push_back(&nres.first->second);
-    }
-  }
-
-  if(raw.find("edges") != raw.end()) {
-    auto edges = raw["edges"];
-    for(auto& edge : edges) {
-      Channel n;
-      auto n1Policy = edge["node1_policy"];
-      auto n2Policy = edge["node2_policy"];
-      if(n1Policy.is_null() && n2Policy.is_null()) {
-        continue;
-      }
-      if(!n1Policy.is_null()) {
-        if(n1Policy["disabled"].get<bool>()) {
-          continue;
-        }
-
-        n.feeA = stoi(n1Policy["fee_base_msat"].get<string>());
-        n.feerateA = stoi(n1Policy["fee_rate_milli_msat"].get<string>());
-      }
-
-      if(!n2Policy.is_null()) {
-        if(n2Policy["disabled"].get<bool>()) {
-          continue;
-        }
-
-        n.feeB = stoi(n2Policy["fee_base_msat"].get<string>());
-        n.feerateB = stoi(n2Policy["fee_rate_milli_msat"].get<string>());
-      }
-
-      n.id = edge["channel_id"].get<std::string>();
-      auto nodeAId = edge["node1_pub"].get<std::string>();
-      auto nodeBId = edge["node2_pub"].get<std::string>();
-      n.nodeA = &g.nodes[nodeAId];
-      n.nodeB = &g.nodes[nodeBId];
-      n.capacity = stoi(edge["capacity"].get<string>());
-      capacity += n.capacity;
-      auto inserted = g.channels.insert({n.id, n});
-      n.nodeA->channels.emplace_back(&inserted.first->second);
-      n.nodeB->channels.emplace_back(&inserted.first->second);
-    }
-  }
-
-  g.capacity = capacity;
-  return g;
-}
-
-void printAPBC(const Graph& g, AP::Graph& apg)
+void printAPBC(const Snapshot& g, AP::Graph& apg)
 {
   auto aps = apg.getResult();
 
   cout << "articulation points: " << aps.articulationPoints.size() << endl;
   cout << "node alias (count of biconnected components it is part of)" << endl;
   for(auto ap : aps.articulationPoints) {
-    auto node = g.nodeVect[ap];
-    cout << node->name << " (" << aps.countComponentsForVertex(ap) << ")" << endl;
+    cout << g.nodeName(ap) << " (" << aps.countComponentsForVertex(ap) << ")" << endl;
   }
   cout << endl;
 
-  cout << "biconnected components: " << aps.biconnectedComponents.size() << endl;
+  // components of node 539 in load order
+  cout << "biconnected components: " << aps.componentCount() << endl;
   cout << "(number of nodes in component){ names of nodes(count of channels) }" << endl;
-  for(auto bc : aps.biconnectedComponents) {
-    // filter components that are only connected to one component
-//    size_t edgeCount = 2;
-//    for(auto n : bc) {
-//      edgeCount = min(edgeCount, g.nodeVect[n]->channels.size());
-//    }
-//    if(edgeCount == 1) {
-//      continue;
-//    }
-    auto print = false;
-    for(auto gn : bc) {
-      if(gn == 539) {
-        print = true;
-      }
-    }
-    if(!print) {
-      continue;
-    }
-    cout << "(" << bc.size() << "){ ";
-    if(bc.size() > 10) {
-      cout << "... ";
-    } else {
-      for(auto gn : bc) {
-        auto n = g.nodeVect[gn];
-        cout << n->name << /*"(" << gn << ")*/"(" << n->channels.size() << "), ";
+  if(539 < g.nodeCount()) {
+    for(auto c : aps.components(g.number(539))) {
+      auto bc = aps.component(c);
+      cout << "(" << bc.size() << "){ ";
+      if(bc.size() > 10) {
+        cout << "... ";
+      } else {
+        for(auto gn : bc) {
+          cout << g.nodeName(gn) << /*"(" << gn << ")*/"(" << g.degree(gn) << "), ";
+        }
       }
+      cout << "}" << endl;
     }
-    cout << "}" << endl;
   }
   cout << endl;
 }
 
-void printPathCost(const Graph& g, digraph::Graph& dig,
+void printPathCost(const Snapshot& g, digraph::Graph& dig,
                    size_t from, size_t to)
 {
   auto path = dig.path(from, to);
   auto cost = dig.cost(from, to);
   auto costPercentage = cost / static_cast<double>(cTtransferAmount) * 100;
 
-  cout << "cheapest path from " << g.nodeVect[from]->name
-       << " to " << g.nodeVect[to]->name
+  cout << "cheapest path from " << g.nodeName(from)
+       << " to " << g.nodeName(to)
        << " which costs " << cost / 1000. << " sat"
        << " that is " << costPercentage << "%" << endl;
   for(auto p : path) {
-    cout << g.nodeVect[p]->name << endl;
+    cout << g.nodeName(p) << endl;
   }
   cout << endl;
 }
 
-void printDistances(const Graph& g, AP::Graph& apg)
+void printDistances(const Snapshot& g, AP::Graph& apg)
 {
-  auto distances = apg.getDistances();
+  vector<uint64_t> pairs;
+  auto distances = apg.getDistances(&pairs);
   map<size_t, size_t> dist;
 
-  for(auto& n : g.nodes) {
-    auto& node = n.second;
-    auto d = distances[node.number];
+  for(size_t n = 0; n < g.nodeCount(); n++) {
+    auto d = distances[n];
     dist[d]++;
   }
 
@@ -200,25 +97,61 @@ void printDistances(const Graph& g, AP::Graph& apg)
   for(auto d : dist) {
     cout << d.second << " x " << d.first << endl;
   }
+  cout << endl;
+
+  auto extremes = apg.getExtremes(distances);
+  cout << "diameter: " << extremes.diameter << ", periphery of "
+       << extremes.periphery.size() << " nodes" << endl;
+  cout << "radius of the largest component: " << extremes.radius
+       << ", center of " << extremes.center.size() << " nodes" << endl;
+  if(extremes.center.size() <= 10) {
+    for(auto n : extremes.center) {
+      cout << g.nodeName(n) << " (" << g.degree(n) << ")" << endl;
+    }
+  }
+  cout << endl;
+
+  if(pairs.empty()) {
+    return;
+  }
+  cout << "shortest distances between all pairs of nodes" << endl;
+  cout << "(count x distance)" << endl;
+  for(size_t d = 1; d < pairs.size(); d++) {
+    cout << pairs[d] << " x " << d << endl;
+  }
+  cout << endl;
+}
 
+void printNeighbourhood(AP::Graph& apg, unsigned log2Registers)
+{
+  auto anf = apg.getNeighbourhood(log2Registers);
+  auto& n = anf.neighbourhood;
+  cout << "approximate distances between all pairs of nodes (HyperANF, "
+       << (1u << log2Registers) << " registers, error "
+       << anf.relativeError * 100 << "%)" << endl;
+  cout << "average distance: " << anf.averageDistance << endl;
+  cout << "effective diameter: " << anf.effectiveDiameter << endl;
+  cout << "(count x distance)" << endl;
+  for(size_t t = 1; t < n.size(); t++) {
+    cout << llround(n[t] - n[t - 1]) << " x " << t << endl;
+  }
   cout << endl;
 }
 
-void printCentrality(const Graph& g, const digraph::Graph& dig) {
+void printCentrality(const Snapshot& g, const digraph::Graph& dig) {
   auto [numPaths, centrality] = dig.centrality();
   std::cout << "count of shortest paths in the network: "
             << numPaths << std::endl;
   std::map<double, size_t> c;
-  for(size_t i = 0; i < g.nodes.size(); i++) {
+  for(size_t i = 0; i < g.nodeCount(); i++) {
     c.insert({centrality[i] * 100. / numPaths, i});
   }
   cout << "centrality of top 20 nodes" << endl;
   cout << "(centrality in %) node name (channels)" << endl;
   int count = 20;
   for(auto& ct : reverse(c)) {
-    auto node = g.nodeVect[ct.second];
-    cout << "(" << std::fixed << std::setprecision(2) << ct.first << ") " << node->name
-         << "(" << node->channels.size() << ")" << endl;
+    cout << "(" << std::fixed << std::setprecision(2) << ct.first << ") " << g.nodeName(ct.second)
+         << "(" << g.degree(ct.second) << ")" << endl;
     if(count-- == 0) {
       break;
     }
@@ -226,49 +159,228 @@ void printCentrality(const Graph& g, const digraph::Graph& dig) {
   cout << endl;
 }
 
-int main()
+int run(int argc, char* argv[])
 {
-  auto g = graphFromJson("C:\\Users\\smenzel\\Documents\\lngraph\\graph.json");
+  string file = "C:\\Users\\smenzel\\Documents\\lngraph\\graph.json";
+  string snapshotOut;
+  bool sax = false;
+  bool parallel = false;
+  bool cln = false;
+  string clnNodes;
+  size_t threads = 0;
+  ingest::Filter filter;
+  filter.now = time(nullptr);
+  bool ingestOnly = false;
+  bool benchmark = false;
+  bool reduceGraph = false;
+  auto order = reorder::Order::Ingest;
+  string engineName = "bfs";
+  unsigned log2Registers = 0;
+  for(int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if(arg == "--sax") {
+      sax = true;
+    } else if(arg == "--parallel") {
+      parallel = true;
+    } else if(arg == "--cln") {
+      cln = true;
+    } else if(arg == "--cln-nodes" && i + 1 < argc) {
+      cln = true;
+      clnNodes = argv[++i];
+    } else if(arg == "--threads" && i + 1 < argc) {
+      threads = stoul(argv[++i]);
+    } else if(arg == "--min-capacity" && i + 1 < argc) {
+      filter.minCapacity = stoll(argv[++i]);
+    } else if(arg == "--max-age" && i + 1 < argc) {
+      filter.maxAge = stoll(argv[++i]);
+    } else if(arg == "--as-of" && i + 1 < argc) {
+      filter.now = stoll(argv[++i]);
+    } else if(arg == "--bidirectional") {
+      filter.bidirectional = true;
+    } else if(arg == "--drop-isolated") {
+      filter.dropIsolated = true;
+    } else if(arg == "--order" && i + 1 < argc) {
+      order = reorder::parse(argv[++i]);
+    } else if(arg == "--distances" && i + 1 < argc) {
+      engineName = argv[++i];
+    } else if(arg == "--hyperanf" && i + 1 < argc) {
+      log2Registers = static_cast<unsigned>(stoul(argv[++i]));
+    } else if(arg == "--reduce") {
+      reduceGraph = true;
+    } else if(arg == "--benchmark") {
+      benchmark = true;
+    } else if(arg == "--ingest-only") {
+      ingestOnly = true;
+    } else if(arg == "--write-snapshot" && i + 1 < argc) {
+      snapshotOut = argv[++i];
+    } else {
+      file = arg;
+    }
+  }
+
+  profile::Stopwatch ingestTime;
+  string loader;
+  vector<string> errors;
+  auto compile = [&](Graph graph) {
+    errors = std::move(graph.errors);
+    return Snapshot::fromGraph(graph);
+  };
+  auto load = [&]() {
+    if(snapshot::isSnapshot(file)) {
+      loader = "snapshot";
+      return Snapshot::open(file);
+    }
+    if(cln) {
+      loader = "cln";
+      return compile(graphFromCln(file, clnNodes, filter));
+    }
+    if(parallel) {
+      loader = "parallel";
+      return compile(graphFromJsonParallel(file, threads, filter));
+    }
+    loader = sax ? "sax" : "dom";
+    return compile(sax ? graphFromJsonSax(file, filter)
+                       : graphFromJson(file, filter));
+  };
+  auto g = load();
+  cout << "ingest (" << loader << "): "
+       << ingestTime.ms() << " ms, peak rss "
+       << profile::peakRss() / (1024 * 1024) << " MB" << endl;
+
+  if(order != reorder::Order::Ingest) {
+    profile::Stopwatch reorderTime;
+    g = g.renumbered(reorder::permutation(g.csr(), order));
+    cout << "reorder: " << reorderTime.ms() << " ms" << endl;
+  }
+
+  if(!errors.empty()) {
+    cout << "skipped " << errors.size() << " malformed records" << endl;
+    for(size_t i = 0; i < errors.size() && i < 10; i++) {
+      cout << "  " << errors[i] << endl;
+    }
+  }
 
-  cout << "nodes:" << g.nodes.size() << endl;
-  cout << "channels:" << g.channels.size() << endl;
-  cout << "capacity:" << g.capacity / 100000000. << endl;
+  if(!snapshotOut.empty()) {
+    g.write(snapshotOut);
+  }
+
+  cout << "nodes:" << g.nodeCount() << endl;
+  cout << "channels:" << g.channelCount() << endl;
+  cout << "fee policies:" << g.policyCount() << endl;
+  cout << "capacity:" << g.capacity() / 100000000. << endl;
   cout << endl;
 
-  AP::Graph apg(g.nodes.size());
+  if(ingestOnly) {
+    return 0;
+  }
+
+  // parallel channels are merged into one edge per node pair, the fee of
+  // a pair is the cheapest of its channels that can carry the amount
+  policy::Table policies(g);
+  std::vector<int64_t> channelCost;
+  std::vector<uint8_t> usable;
+  policies.cost(cTtransferAmount, channelCost);
+  policies.usable(cTtransferAmount, usable);
+  aggregate::Pairs pairs(g.csr(), policies);
+  std::vector<int64_t> cost;
+  pairs.cost(channelCost, usable, cost);
+  auto adj = pairs.graph();
+
+  reduce::Reduction reduction;
+  if(reduceGraph) {
+    profile::Stopwatch reduceTime;
+    reduction = reduce::reduce(adj);
+    cout << "reduce: " << reduceTime.ms() << " ms, core of "
+         << reduction.core.size() << " nodes, "
+         << reduction.pruned.size() << " pruned, "
+         << reduction.chainNodes.size() - 2 * reduction.chainCount()
+         << " in " << reduction.chainCount() << " chains" << endl;
+  }
+  auto core = reduceGraph ? &reduction : nullptr;
+
+  auto engine = AP::parseEngine(engineName);
+  AP::Graph apg(adj, core, threads, engine);
+
+  if(benchmark) {
+    profile::Stopwatch dfsTime;
+    auto aps = apg.getResult();
+    cout << "dfs: " << dfsTime.ms() << " ms, "
+         << aps.componentCount() << " components" << endl;
+
+    profile::Stopwatch serialTime;
+    auto serial = AP::Graph(adj, core, 1).getDistances();
+    auto serialMs = serialTime.ms();
+    cout << "bfs (all sources, 1 thread): " << serialMs << " ms" << endl;
+
+    profile::Stopwatch bfsTime;
+    auto distances = apg.getDistances();
+    auto bfsMs = bfsTime.ms();
+    // an empty graph has no distances
+    size_t diameter = 0;
+    if(!distances.empty()) {
+      diameter = *max_element(distances.begin(), distances.end());
+    }
+    cout << engineName << " (all sources";
+    // bounds always runs on one thread
+    if(engine != AP::Engine::Bounds) {
+      cout << ", " << parallel::threadCount(threads) << " threads";
+    }
+    cout << "): " << bfsMs << " ms, speedup " << serialMs / bfsMs
+         << ", diameter " << diameter << endl;
+    if(distances != serial) {
+      cout << engineName << " differs from the serial bfs" << endl;
+      return 1;
+    }
+
+    if(log2Registers) {
+      profile::Stopwatch anfTime;
+      auto anf = apg.getNeighbourhood(log2Registers);
+      cout << "hyperanf: " << anfTime.ms() << " ms, "
+           << anf.neighbourhood.size() - 1 << " iterations" << endl;
+    }
 
-  for(auto& chan : g.channels) {
-    apg.addEdge(chan.second.nodeA->number, chan.second.nodeB->number);
+    digraph::Graph dig(adj, cost, pairs.capacity(), core);
+    profile::Stopwatch fwTime;
+    dig.floydWarshall(cTtransferAmount, false);
+    cout << "floyd-warshall: " << fwTime.ms() << " ms, max cost "
+         << dig.maxCost() << endl;
+    return 0;
   }
 
   printAPBC(g, apg);
 
   printDistances(g, apg);
 
-  digraph::Graph dig(g.nodes.size());
-
-  for(auto& chan : g.channels) {
-    dig.addEdge(chan.second.nodeA->number,
-                chan.second.nodeB->number,
-                chan.second.feeA
-                + chan.second.feerateA * cTtransferAmount / 1000000,
-                chan.second.capacity * 1000);
-    dig.addEdge(chan.second.nodeB->number,
-                chan.second.nodeA->number,
-                chan.second.feeB
-                + chan.second.feerateB * cTtransferAmount / 1000000,
-                chan.second.capacity * 1000);
+  if(log2Registers) {
+    printNeighbourhood(apg, log2Registers);
   }
 
+  digraph::Graph dig(adj, cost, pairs.capacity(), core);
+
   dig.floydWarshall(cTtransferAmount);
 
   cout << "max cost: " << dig.maxCost() << endl;
   cout << endl;
 
-  printPathCost(g, dig, 30, 7);
-  printPathCost(g, dig, 7, 30);
+  // example nodes by their number when loaded
+  if(g.nodeCount() > 30) {
+    printPathCost(g, dig, g.number(30), g.number(7));
+    printPathCost(g, dig, g.number(7), g.number(30));
+  }
 
   printCentrality(g, dig);
 
   return 0;
 }
+
+int main(int argc, char* argv[])
+{
+  // unreadable or corrupt input, missing decompression support and bad
+  // options end here
+  try {
+    return run(argc, argv);
+  } catch(const exception& e) {
+    cerr << "error: " << e.what() << endl;
+    return 1;
+  }
+}
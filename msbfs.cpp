@@ -0,0 +1,133 @@
+#include "msbfs.h"
+
+#include <algorithm>
+
+#include "parallel.h"
+
+namespace msbfs {
+
+namespace {
+
+int popcount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(x);
+#else
+  int res = 0;
+  for(; x; x &= x - 1) {
+    res++;
+  }
+  return res;
+#endif
+}
+
+// index of the lowest set bit, x != 0
+int lowestBit(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(x);
+#else
+  int res = 0;
+  for(; !(x & 1); x >>= 1) {
+    res++;
+  }
+  return res;
+#endif
+}
+
+// buffers of one thread, reused by all its batches
+struct Search {
+  std::vector<uint64_t> seen;  // bit i set if source i reached the node
+  std::vector<uint64_t> visit; // bit i set if the node is on the frontier of i
+  std::vector<uint64_t> next;  // frontier of the next level
+  std::vector<uint32_t> frontier, nextFrontier; // nodes with visit bits
+  std::vector<uint32_t> reached; // nodes with seen bits
+  std::vector<uint64_t> pairs;
+};
+
+// searches from sources first .. first + count - 1, count <= 64
+void search(const csr::Graph& g, size_t first, size_t count, Search& s,
+            std::vector<size_t>& eccentricity) {
+  if(s.seen.empty()) {
+    s.seen.assign(g.nodeCount(), 0);
+    s.visit.assign(g.nodeCount(), 0);
+    s.next.assign(g.nodeCount(), 0);
+  }
+  s.frontier.clear();
+  s.reached.clear();
+  for(size_t i = 0; i < count; i++) {
+    auto u = static_cast<uint32_t>(first + i);
+    s.seen[u] = s.visit[u] = uint64_t(1) << i;
+    s.frontier.push_back(u);
+    s.reached.push_back(u);
+  }
+  if(s.pairs.empty()) {
+    s.pairs.push_back(0);
+  }
+  s.pairs[0] += count;
+
+  for(size_t d = 1; !s.frontier.empty(); d++) {
+    s.nextFrontier.clear();
+    for(auto u : s.frontier) {
+      auto bits = s.visit[u];
+      for(auto v : g.neighbours(u)) {
+        auto add = bits & ~s.seen[v];
+        if(add) {
+          if(!s.next[v]) {
+            s.nextFrontier.push_back(v);
+          }
+          s.next[v] |= add;
+        }
+      }
+      s.visit[u] = 0;
+    }
+
+    // searches that still reach new nodes, their eccentricity is at least d
+    uint64_t active = 0;
+    uint64_t found = 0;
+    for(auto v : s.nextFrontier) {
+      s.seen[v] |= s.next[v];
+      active |= s.next[v];
+      found += static_cast<uint64_t>(popcount(s.next[v]));
+      s.reached.push_back(v);
+    }
+    if(active) {
+      if(s.pairs.size() <= d) {
+        s.pairs.resize(d + 1, 0);
+      }
+      s.pairs[d] += found;
+    }
+    for(; active; active &= active - 1) {
+      eccentricity[first + static_cast<size_t>(lowestBit(active))] = d;
+    }
+    std::swap(s.visit, s.next);
+    std::swap(s.frontier, s.nextFrontier);
+  }
+
+  for(auto u : s.reached) {
+    s.seen[u] = 0;
+  }
+}
+}
+
+Result run(const csr::Graph& g, size_t threads) {
+  auto nodes = g.nodeCount();
+  Result res;
+  res.eccentricity.assign(nodes, 0);
+  std::vector<Search> searches(parallel::threadCount(threads));
+  parallel::forEach((nodes + cBatch - 1) / cBatch, threads,
+                    [&](size_t t, size_t b) {
+    auto first = b * cBatch;
+    search(g, first, std::min(cBatch, nodes - first), searches[t],
+           res.eccentricity);
+  });
+
+  for(auto& s : searches) {
+    if(res.pairs.size() < s.pairs.size()) {
+      res.pairs.resize(s.pairs.size(), 0);
+    }
+    for(size_t d = 0; d < s.pairs.size(); d++) {
+      res.pairs[d] += s.pairs[d];
+    }
+  }
+  return res;
+}
+}
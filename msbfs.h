@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "csr.h"
+
+// multi-source breadth first search (MS-BFS).
+// the searches from 64 sources run together, every node keeps one bit per
+// source for seen and frontier. a level ORs the frontier words of a node
+// into its neighbours, so one pass over the adjacency advances all 64
+// searches.
+namespace msbfs {
+
+constexpr size_t cBatch = 64;
+
+struct Result {
+  // hops from each node to the farthest node it reaches
+  std::vector<size_t> eccentricity;
+  // pairs[d] = ordered pairs of nodes (s, t) where t is d hops from s,
+  // pairs[0] counts every node with itself
+  std::vector<uint64_t> pairs;
+};
+
+// searches from all nodes, batches of cBatch sources run on threads
+// threads (0 = one per core)
+Result run(const csr::Graph& g, size_t threads = 1);
+}
@@ -0,0 +1,121 @@
+#include "nodeIndex.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// nibble value of every byte, -1 for anything that isn't a hex digit
+struct HexTable {
+  int8_t value[256];
+
+  constexpr HexTable() : value() {
+    for(int c = 0; c < 256; c++) {
+      value[c] = -1;
+    }
+    for(int c = '0'; c <= '9'; c++) {
+      value[c] = static_cast<int8_t>(c - '0');
+    }
+    for(int c = 'a'; c <= 'f'; c++) {
+      value[c] = static_cast<int8_t>(c - 'a' + 10);
+      value[c - 'a' + 'A'] = static_cast<int8_t>(c - 'a' + 10);
+    }
+  }
+};
+
+constexpr HexTable cHex;
+}
+
+bool decodePubKey(std::string_view hex, PubKey& key) {
+  if(hex.size() != 2 * cPubKeySize) {
+    return false;
+  }
+  int bad = 0;
+  for(size_t i = 0; i < cPubKeySize; i++) {
+    int hi = cHex.value[static_cast<uint8_t>(hex[2 * i])];
+    int lo = cHex.value[static_cast<uint8_t>(hex[2 * i + 1])];
+    bad |= hi | lo;
+    key[i] = static_cast<uint8_t>((hi & 0xf) << 4 | (lo & 0xf));
+  }
+  return bad >= 0;
+}
+
+std::string encodePubKey(const PubKey& key) {
+  static const char digits[] = "0123456789abcdef";
+  std::string res(2 * cPubKeySize, '0');
+  for(size_t i = 0; i < cPubKeySize; i++) {
+    res[2 * i] = digits[key[i] >> 4];
+    res[2 * i + 1] = digits[key[i] & 0xf];
+  }
+  return res;
+}
+
+NodeIndex::NodeIndex() :
+  slots_(16, cEmpty)
+, mask_(15)
+{
+}
+
+// the key after the parity byte is the x coordinate of a curve point,
+// so any 8 bytes of it are already uniformly distributed.
+size_t NodeIndex::slot(const PubKey& key) const {
+  uint64_t h;
+  std::memcpy(&h, key.data() + 1, sizeof(h));
+  return (h * 0x9e3779b97f4a7c15ull >> 32) & mask_;
+}
+
+size_t NodeIndex::find(const PubKey& key) const {
+  for(auto s = slot(key); ; s = (s + 1) & mask_) {
+    auto n = slots_[s];
+    if(n == cEmpty) {
+      return npos;
+    }
+    if(keys_[n] == key) {
+      return n;
+    }
+  }
+}
+
+std::pair<size_t, bool> NodeIndex::insert(const PubKey& key) {
+  auto s = slot(key);
+  for(; slots_[s] != cEmpty; s = (s + 1) & mask_) {
+    if(keys_[slots_[s]] == key) {
+      return {slots_[s], false};
+    }
+  }
+  if(keys_.size() >= cEmpty - 1) {
+    throw std::runtime_error("too many nodes for NodeIndex");
+  }
+
+  auto n = keys_.size();
+  keys_.push_back(key);
+  slots_[s] = static_cast<uint32_t>(n);
+  // keep the load factor below 1/2
+  if(2 * keys_.size() > slots_.size()) {
+    rehash(2 * slots_.size());
+  }
+  return {n, true};
+}
+
+void NodeIndex::reserve(size_t n) {
+  keys_.reserve(n);
+  size_t slots = slots_.size();
+  while(slots < 2 * n) {
+    slots *= 2;
+  }
+  if(slots != slots_.size()) {
+    rehash(slots);
+  }
+}
+
+void NodeIndex::rehash(size_t slots) {
+  slots_.assign(slots, cEmpty);
+  mask_ = slots - 1;
+  for(size_t n = 0; n < keys_.size(); n++) {
+    auto s = slot(keys_[n]);
+    while(slots_[s] != cEmpty) {
+      s = (s + 1) & mask_;
+    }
+    slots_[s] = static_cast<uint32_t>(n);
+  }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+constexpr size_t cPubKeySize = 33; // compressed secp256k1 point
+
+using PubKey = std::array<uint8_t, cPubKeySize>;
+
+// decodes a 66 character hex pub_key, false if it isn't one
+bool decodePubKey(std::string_view hex, PubKey& key);
+std::string encodePubKey(const PubKey& key);
+
+// maps pub_keys to dense node numbers.
+// the keys are kept contiguously in insertion order (the key of node n is
+// key(n)) and are indexed by a flat open addressing table with linear
+// probing, so a lookup is one hash and usually one probe.
+class NodeIndex
+{
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  NodeIndex();
+
+  // node number of key, or npos if it is unknown
+  size_t find(const PubKey& key) const;
+  // node number of key and whether it was added by this call
+  std::pair<size_t, bool> insert(const PubKey& key);
+
+  const PubKey& key(size_t n) const { return keys_[n]; }
+  size_t size() const { return keys_.size(); }
+
+  void reserve(size_t n);
+
+private:
+  static constexpr uint32_t cEmpty = static_cast<uint32_t>(-1);
+
+  size_t slot(const PubKey& key) const;
+  void rehash(size_t slots);
+
+  std::vector<PubKey> keys_;
+  std::vector<uint32_t> slots_; // node number or cEmpty
+  size_t mask_;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+
+namespace numeric {
+
+// parses all of text as a decimal integer. fails on empty input,
+// trailing characters and values that don't fit into int64.
+// doesn't allocate and doesn't throw.
+inline bool parse(std::string_view text, int64_t& value) {
+  int64_t v;
+  auto end = text.data() + text.size();
+  auto res = std::from_chars(text.data(), end, v);
+  if(res.ec != std::errc() || res.ptr != end) {
+    return false;
+  }
+  value = v;
+  return true;
+}
+
+// parses all of text as an unsigned decimal integer that fits into 64 bit
+inline bool parseUnsigned(std::string_view text, uint64_t& value) {
+  uint64_t v;
+  auto end = text.data() + text.size();
+  auto res = std::from_chars(text.data(), end, v);
+  if(res.ec != std::errc() || res.ptr != end) {
+    return false;
+  }
+  value = v;
+  return true;
+}
+
+// as parse, but also rejects negative values.
+// capacities, fees and feerates are unsigned in the node implementations.
+inline bool parseAmount(std::string_view text, int64_t& value) {
+  int64_t v;
+  if(!parse(text, v) || v < 0) {
+    return false;
+  }
+  value = v;
+  return true;
+}
+
+// parses a short channel id in the "<block>x<tx>x<output>" notation into
+// its 64 bit form (block << 40 | tx << 16 | output).
+inline bool parseShortChannelId(std::string_view text, uint64_t& scid) {
+  uint64_t part[3];
+  auto p = text.data();
+  auto end = text.data() + text.size();
+  for(int i = 0; i < 3; i++) {
+    auto res = std::from_chars(p, end, part[i]);
+    if(res.ec != std::errc()) {
+      return false;
+    }
+    p = res.ptr;
+    if(i < 2) {
+      if(p == end || *p != 'x') {
+        return false;
+      }
+      p++;
+    }
+  }
+  if(p != end || part[0] >= 1u << 24 || part[1] >= 1u << 24 || part[2] >= 1u << 16) {
+    return false;
+  }
+  scid = part[0] << 40 | part[1] << 16 | part[2];
+  return true;
+}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+// number of threads to use when threads were requested, 0 = one per core
+inline size_t threadCount(size_t threads) {
+  if(threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  return threads;
+}
+
+// calls f(worker, i) for every i in [0, count) on a pool of threads.
+// every worker starts with its own contiguous share of the indices and
+// takes grain of them at a time from the front of it. when its share is
+// done it steals from the shares of the other workers, so uneven work
+// still keeps all threads busy.
+// worker is in [0, threadCount(threads)), callers use it to keep buffers
+// per thread. the first exception of f is rethrown after all workers
+// stopped.
+template <typename F>
+void forEach(size_t count, size_t threads, F f, size_t grain = 1) {
+  threads = std::max<size_t>(1, std::min(threadCount(threads), count));
+
+  struct alignas(64) Share {
+    std::atomic<size_t> next;
+    size_t end;
+  };
+  std::unique_ptr<Share[]> shares(new Share[threads]);
+  for(size_t t = 0; t < threads; t++) {
+    shares[t].next = count * t / threads;
+    shares[t].end = count * (t + 1) / threads;
+  }
+  std::atomic<bool> failed{false};
+  std::vector<std::exception_ptr> errors(threads);
+
+  auto worker = [&](size_t t) {
+    try {
+      // own share first, then the others
+      for(size_t k = 0; k < threads && !failed; k++) {
+        auto& share = shares[(t + k) % threads];
+        for(size_t i = share.next.fetch_add(grain); i < share.end && !failed;
+            i = share.next.fetch_add(grain)) {
+          auto last = std::min(i + grain, share.end);
+          for(; i < last; i++) {
+            f(t, i);
+          }
+        }
+      }
+    } catch(...) {
+      errors[t] = std::current_exception();
+      failed = true;
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for(size_t t = 1; t < threads; t++) {
+    pool.emplace_back(worker, t);
+  }
+  worker(0);
+  for(auto& th : pool) {
+    th.join();
+  }
+  for(auto& e : errors) {
+    if(e) {
+      std::rethrow_exception(e);
+    }
+  }
+}
+}
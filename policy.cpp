@@ -0,0 +1,201 @@
+#include "policy.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+  && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace policy {
+
+namespace {
+
+void costScalar(const int64_t* base, const int64_t* rate, size_t n,
+                int64_t amount, int64_t* cost) {
+  for(size_t i = 0; i < n; i++) {
+    cost[i] = base[i] + rate[i] * amount / 1000000;
+  }
+}
+
+void usableScalar(const int64_t* capacity, size_t n,
+                  int64_t amount, uint8_t* usable) {
+  for(size_t i = 0; i < n; i++) {
+    usable[i] = capacity[i] >= amount;
+  }
+}
+
+void gatherScalar(const int64_t* values, const uint32_t* index, size_t n,
+                  int64_t* res) {
+  for(size_t i = 0; i < n; i++) {
+    res[i] = values[index[i]];
+  }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+// integers in [0, 2^51) are converted to and from double by adding 2^52
+// and reinterpreting the bits, AVX2 has no 64 bit integer conversion.
+constexpr double cMagic = 4503599627370496.0; // 2^52
+constexpr int64_t cExactLimit = int64_t(1) << 51;
+
+// rate * amount must be in [0, 2^51), then the product and multiples of
+// 1000000 below it are exact in double. the quotient is estimated with the
+// reciprocal and corrected by one in either direction, which avoids the
+// slow vector division.
+__attribute__((target("avx2")))
+void costAvx2(const int64_t* base, const int64_t* rate, size_t n,
+              int64_t amount, int64_t* cost) {
+  auto magicD = _mm256_set1_pd(cMagic);
+  auto magicI = _mm256_castpd_si256(magicD);
+  auto amountD = _mm256_set1_pd(static_cast<double>(amount));
+  auto million = _mm256_set1_pd(1000000.);
+  auto inverse = _mm256_set1_pd(1. / 1000000.);
+  auto one = _mm256_set1_pd(1.);
+  size_t i = 0;
+  for(; i + 4 <= n; i += 4) {
+    auto r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rate + i));
+    auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(base + i));
+    auto rd = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(r, magicI)),
+                            magicD);
+    auto p = _mm256_mul_pd(rd, amountD);
+    auto q = _mm256_round_pd(_mm256_mul_pd(p, inverse),
+                             _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    auto over = _mm256_cmp_pd(_mm256_mul_pd(q, million), p, _CMP_GT_OQ);
+    q = _mm256_sub_pd(q, _mm256_and_pd(over, one));
+    auto under = _mm256_cmp_pd(_mm256_mul_pd(_mm256_add_pd(q, one), million),
+                               p, _CMP_LE_OQ);
+    q = _mm256_add_pd(q, _mm256_and_pd(under, one));
+    auto qi = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(q, magicD)),
+                               magicI);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(cost + i),
+                        _mm256_add_epi64(b, qi));
+  }
+  costScalar(base + i, rate + i, n - i, amount, cost + i);
+}
+
+__attribute__((target("avx2")))
+void gatherAvx2(const int64_t* values, const uint32_t* index, size_t n,
+                int64_t* res) {
+  size_t i = 0;
+  for(; i + 4 <= n; i += 4) {
+    auto idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(index + i));
+    auto v = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(values),
+                                    idx, 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(res + i), v);
+  }
+  gatherScalar(values, index + i, n - i, res + i);
+}
+
+// four usable flags as bytes for each compare mask, little endian
+constexpr uint32_t makeUsableBytes(int m) {
+  uint32_t res = 0;
+  for(int k = 0; k < 4; k++) {
+    if(!((m >> k) & 1)) {
+      res |= uint32_t(1) << (8 * k);
+    }
+  }
+  return res;
+}
+constexpr uint32_t cUsableBytes[16] = {
+  makeUsableBytes(0), makeUsableBytes(1), makeUsableBytes(2),
+  makeUsableBytes(3), makeUsableBytes(4), makeUsableBytes(5),
+  makeUsableBytes(6), makeUsableBytes(7), makeUsableBytes(8),
+  makeUsableBytes(9), makeUsableBytes(10), makeUsableBytes(11),
+  makeUsableBytes(12), makeUsableBytes(13), makeUsableBytes(14),
+  makeUsableBytes(15)
+};
+
+__attribute__((target("avx2")))
+void usableAvx2(const int64_t* capacity, size_t n,
+                int64_t amount, uint8_t* usable) {
+  auto a = _mm256_set1_epi64x(amount);
+  size_t i = 0;
+  for(; i + 4 <= n; i += 4) {
+    auto c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(capacity + i));
+    // bit k set if amount > capacity[i + k]
+    auto m = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(a, c)));
+    auto bytes = cUsableBytes[m];
+    std::memcpy(usable + i, &bytes, sizeof(bytes));
+  }
+  usableScalar(capacity + i, n - i, amount, usable + i);
+}
+
+bool hasAvx2() {
+  static const bool res = __builtin_cpu_supports("avx2");
+  return res;
+}
+#endif
+}
+
+Table::Table(const snapshot::Snapshot& g) :
+  policy_(2 * g.channelCount())
+, base_(g.policyCount())
+, rate_(g.policyCount())
+, capacity_(2 * g.channelCount())
+{
+  // edges without a policy point behind the dictionary, cost() puts
+  // cUnpriced there
+  auto none = static_cast<uint32_t>(g.policyCount());
+  for(size_t c = 0; c < g.channelCount(); c++) {
+    uint32_t ids[2] = {g.policyA(c), g.policyB(c)};
+    for(uint32_t d = 0; d < 2; d++) {
+      auto e = 2 * c + d;
+      policy_[e] = ids[d] != snapshot::cNoPolicy ? ids[d] : none;
+      if(ids[d] == snapshot::cNoPolicy) {
+        unpriced_.push_back(static_cast<uint32_t>(e));
+      }
+    }
+    capacity_[2 * c] = capacity_[2 * c + 1] = g.capacity(c) * 1000;
+  }
+  for(size_t p = 0; p < g.policyCount(); p++) {
+    base_[p] = g.fee(p);
+    rate_[p] = g.feerate(p);
+  }
+  if(!rate_.empty()) {
+    auto minMax = std::minmax_element(rate_.begin(), rate_.end());
+    minRate_ = *minMax.first;
+    maxRate_ = *minMax.second;
+  }
+}
+
+void Table::cost(int64_t amount, std::vector<int64_t>& cost) const {
+  // a few hundred distinct policies, evaluated once for all edges
+  std::vector<int64_t> policyCost(policyCount() + 1);
+  evaluate(amount, policyCost.data());
+  policyCost.back() = cUnpriced;
+  cost.resize(size());
+#ifdef HAVE_AVX2_KERNELS
+  if(hasAvx2()) {
+    gatherAvx2(policyCost.data(), policy_.data(), size(), cost.data());
+    return;
+  }
+#endif
+  gatherScalar(policyCost.data(), policy_.data(), size(), cost.data());
+}
+
+void Table::evaluate(int64_t amount, int64_t* cost) const {
+#ifdef HAVE_AVX2_KERNELS
+  if(hasAvx2() && amount >= 0 && minRate_ >= 0
+     && (maxRate_ == 0 || amount < cExactLimit / maxRate_)) {
+    costAvx2(base_.data(), rate_.data(), policyCount(), amount, cost);
+    return;
+  }
+#endif
+  costScalar(base_.data(), rate_.data(), policyCount(), amount, cost);
+}
+
+void Table::usable(int64_t amount, std::vector<uint8_t>& usable) const {
+  usable.resize(size());
+#ifdef HAVE_AVX2_KERNELS
+  auto kernel = hasAvx2() ? usableAvx2 : usableScalar;
+#else
+  auto kernel = usableScalar;
+#endif
+  kernel(capacity_.data(), size(), amount, usable.data());
+  for(auto e : unpriced_) {
+    usable[e] = 0;
+  }
+}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "snapshot.h"
+
+namespace policy {
+
+// cost of an edge without a policy
+constexpr int64_t cUnpriced = std::numeric_limits<int64_t>::max();
+
+// fee policies and capacities of all directed edges, indexed by directed
+// edge id (see csr::Graph). edges refer to the distinct policies of the
+// snapshot, cost() evaluates each policy once and gathers the result per
+// edge. the kernels use AVX2 when the cpu supports it.
+// edges without a policy (snapshot::cNoPolicy) cost cUnpriced and are
+// never usable.
+class Table
+{
+public:
+  explicit Table(const snapshot::Snapshot& g);
+
+  size_t size() const { return policy_.size(); }
+  size_t policyCount() const { return base_.size(); }
+
+  // policy id by edge, policyCount() for edges without a policy, base
+  // and rate by policy id
+  const std::vector<uint32_t>& policy() const { return policy_; }
+  bool hasPolicy(size_t e) const { return policy_[e] != policyCount(); }
+  const std::vector<int64_t>& base() const { return base_; }
+  const std::vector<int64_t>& rate() const { return rate_; }
+  const std::vector<int64_t>& capacity() const { return capacity_; }
+
+  // cost[e] = base[p] + rate[p] * amount / 1000000 with p = policy[e],
+  // millisatoshi, cUnpriced without a policy
+  void cost(int64_t amount, std::vector<int64_t>& cost) const;
+  // usable[e] = 1 if edge e can carry amount, else 0
+  void usable(int64_t amount, std::vector<uint8_t>& usable) const;
+
+private:
+  std::vector<uint32_t> policy_;  // by edge
+  std::vector<int64_t> base_;     // millisatoshi
+  std::vector<int64_t> rate_;     // one millionth
+  std::vector<int64_t> capacity_; // millisatoshi
+  std::vector<uint32_t> unpriced_; // edges without a policy
+  int64_t minRate_ = 0;
+  int64_t maxRate_ = 0;
+
+  // cost of every policy
+  void evaluate(int64_t amount, int64_t* cost) const;
+};
+}
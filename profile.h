@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace profile {
+
+// peak resident set size of the process so far, in bytes
+inline size_t peakRss() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  if(GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+    return pmc.PeakWorkingSetSize;
+  }
+  return 0;
+#else
+  rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);        // bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes on linux
+#endif
+  }
+  return 0;
+#endif
+}
+
+class Stopwatch
+{
+public:
+  Stopwatch() : start_(std::chrono::steady_clock::now()) {}
+
+  double ms() const {
+    std::chrono::duration<double, std::milli> d =
+        std::chrono::steady_clock::now() - start_;
+    return d.count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point start_;
+};
+}
@@ -0,0 +1,143 @@
+#include "reduce.h"
+
+namespace reduce {
+
+namespace {
+
+Reduction init(size_t nodes) {
+  Reduction r;
+  r.kind.assign(nodes, Core);
+  r.parent.assign(nodes, cNone);
+  r.anchor.resize(nodes);
+  r.depth.assign(nodes, 0);
+  r.coreIndex.assign(nodes, cNone);
+  r.chain.assign(nodes, cNone);
+  r.slot.assign(nodes, cNone);
+  for(size_t n = 0; n < nodes; n++) {
+    r.anchor[n] = static_cast<uint32_t>(n);
+  }
+  return r;
+}
+
+void indexCore(Reduction& r) {
+  for(size_t n = 0; n < r.nodeCount(); n++) {
+    if(r.kind[n] == Core) {
+      r.coreIndex[n] = static_cast<uint32_t>(r.core.size());
+      r.core.push_back(static_cast<uint32_t>(n));
+    }
+  }
+}
+}
+
+Reduction none(size_t nodes) {
+  auto r = init(nodes);
+  indexCore(r);
+  return r;
+}
+
+Reduction reduce(const csr::Graph& g) {
+  auto nodes = g.nodeCount();
+  auto r = init(nodes);
+
+  // distinct neighbours, parallel channels and loops don't count
+  std::vector<uint32_t> degree(nodes, 0);
+  std::vector<bool> loop(nodes, false);
+  std::vector<uint32_t> seen(nodes, cNone);
+  for(uint32_t u = 0; u < nodes; u++) {
+    for(auto v : g.neighbours(u)) {
+      if(v == u) {
+        loop[u] = true;
+      } else if(seen[v] != u) {
+        seen[v] = u;
+        degree[u]++;
+      }
+    }
+  }
+
+  // prune pendant nodes until none are left. the last node of a tree
+  // component has no neighbours left and stays.
+  std::vector<uint32_t> queue;
+  for(uint32_t u = 0; u < nodes; u++) {
+    if(degree[u] == 1 && !loop[u]) {
+      queue.push_back(u);
+    }
+  }
+  for(size_t head = 0; head < queue.size(); head++) {
+    auto u = queue[head];
+    if(r.kind[u] == Tree || degree[u] != 1) {
+      continue;
+    }
+    uint32_t p = cNone;
+    for(auto v : g.neighbours(u)) {
+      if(v != u && r.kind[v] != Tree) {
+        p = v;
+        break;
+      }
+    }
+    r.kind[u] = Tree;
+    r.parent[u] = p;
+    r.pruned.push_back(u);
+    degree[u] = 0;
+    if(--degree[p] == 1 && !loop[p]) {
+      queue.push_back(p);
+    }
+  }
+  // parents are pruned after their children
+  for(auto i = r.pruned.rbegin(); i != r.pruned.rend(); ++i) {
+    auto p = r.parent[*i];
+    r.anchor[*i] = r.anchor[p];
+    r.depth[*i] = r.depth[p] + 1;
+  }
+
+  // inner nodes of chains have exactly two remaining neighbours
+  for(uint32_t u = 0; u < nodes; u++) {
+    if(r.kind[u] == Core && degree[u] == 2 && !loop[u]) {
+      r.kind[u] = Chain;
+    }
+  }
+  // the other remaining neighbour of inner node u
+  auto other = [&](uint32_t u, uint32_t prev) {
+    for(auto v : g.neighbours(u)) {
+      if(v != prev && r.kind[v] != Tree) {
+        return v;
+      }
+    }
+    return cNone;
+  };
+  auto walk = [&](uint32_t start) {
+    for(auto v : g.neighbours(start)) {
+      if(r.kind[v] != Chain || r.chain[v] != cNone) {
+        continue;
+      }
+      auto c = static_cast<uint32_t>(r.chainCount());
+      r.chainNodes.push_back(start);
+      auto prev = start;
+      while(r.kind[v] == Chain && r.chain[v] == cNone) {
+        r.chain[v] = c;
+        r.slot[v] = static_cast<uint32_t>(r.chainNodes.size());
+        r.chainNodes.push_back(v);
+        auto next = other(v, prev);
+        prev = v;
+        v = next;
+      }
+      r.chainNodes.push_back(v);
+      r.chainOffsets.push_back(static_cast<uint32_t>(r.chainNodes.size()));
+    }
+  };
+  for(uint32_t u = 0; u < nodes; u++) {
+    if(r.kind[u] == Core) {
+      walk(u);
+    }
+  }
+  // cycles without a core node keep one of their nodes in the core
+  for(uint32_t u = 0; u < nodes; u++) {
+    if(r.kind[u] == Chain && r.chain[u] == cNone) {
+      r.kind[u] = Core;
+      walk(u);
+    }
+  }
+
+  indexCore(r);
+  return r;
+}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "csr.h"
+
+// structural reduction of the channel graph for the all-pairs analyses.
+//
+// trees hanging off the graph (pendant nodes, repeatedly) are pruned and
+// paths of nodes with exactly two neighbours are contracted into chains
+// between the remaining core nodes. every shortest path between removed
+// nodes leaves their tree through its anchor and their chain through one
+// of its ends, so all-pairs results can be computed on the core and
+// reconstructed for the removed nodes.
+// parallel channels count as one neighbour, nodes with a channel to
+// themselves always stay in the core.
+namespace reduce {
+
+constexpr uint32_t cNone = std::numeric_limits<uint32_t>::max();
+
+enum Kind : uint8_t {
+  Core,
+  Chain, // inner node of a chain
+  Tree   // pruned
+};
+
+struct Reduction {
+  std::vector<uint8_t> kind;      // Kind per node
+  std::vector<uint32_t> parent;   // Tree: next node towards the anchor
+  std::vector<uint32_t> anchor;   // first non Tree node upwards, else itself
+  std::vector<uint32_t> depth;    // Tree: hops to the anchor
+  std::vector<uint32_t> pruned;   // Tree nodes, leaves before their parents
+
+  std::vector<uint32_t> core;      // Core nodes
+  std::vector<uint32_t> coreIndex; // index into core, cNone if not Core
+
+  // chain c is chainNodes[chainOffsets[c], chainOffsets[c + 1]),
+  // first and last are its (Core) ends, they are equal for a cycle.
+  std::vector<uint32_t> chainOffsets{0};
+  std::vector<uint32_t> chainNodes;
+  std::vector<uint32_t> chain; // Chain: chain number
+  std::vector<uint32_t> slot;  // Chain: index into chainNodes
+
+  size_t nodeCount() const { return kind.size(); }
+  size_t chainCount() const { return chainOffsets.size() - 1; }
+};
+
+// every node in the core
+Reduction none(size_t nodes);
+
+Reduction reduce(const csr::Graph& g);
+}
@@ -0,0 +1,102 @@
+#include "reorder.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace reorder {
+
+namespace {
+
+// nodes by descending degree, ties in current order
+std::vector<uint32_t> byDegree(const csr::Graph& g) {
+  std::vector<uint32_t> res(g.nodeCount());
+  std::iota(res.begin(), res.end(), 0);
+  std::stable_sort(res.begin(), res.end(), [&](uint32_t a, uint32_t b) {
+    return g.degree(a) > g.degree(b);
+  });
+  return res;
+}
+
+// breadth first traversal of all components, started from the nodes of
+// starts in that order. with sortByDegree the neighbours of a node are
+// enqueued by ascending degree (Cuthill-McKee), otherwise in adjacency
+// order.
+std::vector<uint32_t> traverse(const csr::Graph& g,
+                               const std::vector<uint32_t>& starts,
+                               bool sortByDegree) {
+  std::vector<uint32_t> res;
+  res.reserve(g.nodeCount());
+  std::vector<bool> visited(g.nodeCount(), false);
+  std::vector<uint32_t> next;
+  for(auto s : starts) {
+    if(visited[s]) {
+      continue;
+    }
+    visited[s] = true;
+    res.push_back(s);
+    // res doubles as the queue
+    for(size_t head = res.size() - 1; head < res.size(); head++) {
+      next.clear();
+      for(auto v : g.neighbours(res[head])) {
+        if(!visited[v]) {
+          visited[v] = true;
+          next.push_back(v);
+        }
+      }
+      if(sortByDegree) {
+        std::stable_sort(next.begin(), next.end(), [&](uint32_t a, uint32_t b) {
+          return g.degree(a) < g.degree(b);
+        });
+      }
+      res.insert(res.end(), next.begin(), next.end());
+    }
+  }
+  return res;
+}
+}
+
+Order parse(const std::string& name) {
+  if(name == "ingest") {
+    return Order::Ingest;
+  } else if(name == "rcm") {
+    return Order::Rcm;
+  } else if(name == "degree") {
+    return Order::Degree;
+  } else if(name == "bfs") {
+    return Order::Bfs;
+  }
+  throw std::runtime_error("unknown node order " + name);
+}
+
+std::vector<uint32_t> permutation(const csr::Graph& g, Order order) {
+  std::vector<uint32_t> sequence; // old numbers in their new order
+  switch(order) {
+  case Order::Ingest:
+    sequence.resize(g.nodeCount());
+    std::iota(sequence.begin(), sequence.end(), 0);
+    break;
+  case Order::Degree:
+    sequence = byDegree(g);
+    break;
+  case Order::Bfs:
+    sequence = traverse(g, byDegree(g), false);
+    break;
+  case Order::Rcm: {
+    // start each component at a node of minimum degree, a cheap
+    // approximation of a peripheral node
+    auto starts = byDegree(g);
+    std::reverse(starts.begin(), starts.end());
+    sequence = traverse(g, starts, true);
+    std::reverse(sequence.begin(), sequence.end());
+    break;
+  }
+  }
+
+  std::vector<uint32_t> res(g.nodeCount());
+  for(size_t i = 0; i < sequence.size(); i++) {
+    res[sequence[i]] = static_cast<uint32_t>(i);
+  }
+  return res;
+}
+}
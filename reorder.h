@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "csr.h"
+
+// node renumbering to improve memory locality of the analyses.
+// neighbours get close numbers, so adjacency lists, per node arrays and
+// the rows of the dense digraph matrices touched together are close in
+// memory.
+namespace reorder {
+
+enum class Order {
+  Ingest, // keep the numbers assigned while loading
+  Rcm,    // reverse Cuthill-McKee, small bandwidth
+  Degree, // by number of channels, hubs first
+  Bfs     // breadth first from the largest hub of each component
+};
+
+// "ingest", "rcm", "degree" or "bfs"
+Order parse(const std::string& name);
+
+// permutation[old number] = new number
+std::vector<uint32_t> permutation(const csr::Graph& g, Order order);
+}
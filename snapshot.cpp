@@ -0,0 +1,306 @@
+#include "snapshot.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace snapshot {
+
+namespace {
+
+size_t align8(size_t n) {
+  return (n + 7) & ~static_cast<size_t>(7);
+}
+
+template <typename T>
+size_t expectedSize(uint64_t count) {
+  return static_cast<size_t>(count) * sizeof(T);
+}
+
+// distinct (fee, feerate) pairs in order of first use. most channels use
+// one of a few default policies, so the dictionary stays small.
+class PolicyDictionary
+{
+public:
+  uint32_t add(int64_t fee, int64_t feerate) {
+    auto id = static_cast<uint32_t>(fee_.size());
+    auto it = index_.emplace(Key{fee, feerate}, id);
+    if(it.second) {
+      fee_.push_back(fee);
+      feerate_.push_back(feerate);
+    }
+    return it.first->second;
+  }
+
+  const std::vector<int64_t>& fees() const { return fee_; }
+  const std::vector<int64_t>& feerates() const { return feerate_; }
+
+private:
+  struct Key {
+    int64_t fee;
+    int64_t feerate;
+    bool operator==(const Key& o) const {
+      return fee == o.fee && feerate == o.feerate;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key& k) const {
+      return std::hash<int64_t>()(k.fee) * 31 + std::hash<int64_t>()(k.feerate);
+    }
+  };
+
+  std::unordered_map<Key, uint32_t, KeyHash> index_;
+  std::vector<int64_t> fee_, feerate_;
+};
+}
+
+// raw bytes of all sections before they are laid out in the file
+struct Snapshot::Sections {
+  std::vector<char> data[SectionCount];
+
+  template <typename T>
+  void put(Section s, const std::vector<T>& v) {
+    auto p = reinterpret_cast<const char*>(v.data());
+    data[s].assign(p, p + v.size() * sizeof(T));
+  }
+};
+
+bool isSnapshot(const std::string& path) {
+  if(path == "-") {
+    return false;
+  }
+  std::ifstream t(path, std::ios::in | std::ifstream::binary);
+  char magic[sizeof(cMagic)];
+  return t.read(magic, sizeof(magic))
+      && std::memcmp(magic, cMagic, sizeof(cMagic)) == 0;
+}
+
+Snapshot Snapshot::open(const std::string& path) {
+  Snapshot s;
+  s.file_ = std::make_unique<InputBuffer>(path, false,
+                                          InputBuffer::Access::Normal);
+  s.base_ = s.file_->data();
+  s.size_ = s.file_->size();
+  s.validate(s.size_);
+  s.header_ = reinterpret_cast<const Header*>(s.base_);
+  return s;
+}
+
+Snapshot Snapshot::fromGraph(const Graph& g) {
+  auto nodes = g.nodes.size();
+  auto channels = g.channels.size();
+  if(nodes >= std::numeric_limits<uint32_t>::max()
+     || 2 * channels >= std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("graph too large for snapshot format");
+  }
+
+  StringPool nodeIds, nodeNames;
+  for(size_t n = 0; n < nodes; n++) {
+    nodeIds.add(encodePubKey(g.pubKey(n)));
+    nodeNames.add(g.name(n));
+  }
+
+  std::vector<uint64_t> channelIds;
+  std::vector<uint32_t> nodeA, nodeB, policyA, policyB;
+  std::vector<int64_t> capacity;
+  PolicyDictionary policies;
+  for(auto& chan : g.channels) {
+    if(chan.nodeA >= nodes || chan.nodeB >= nodes) {
+      throw std::runtime_error("channel " + std::to_string(chan.id)
+                               + " references unknown node");
+    }
+    channelIds.push_back(chan.id);
+    nodeA.push_back(chan.nodeA);
+    nodeB.push_back(chan.nodeB);
+    capacity.push_back(chan.capacity);
+    policyA.push_back(chan.policyA ? policies.add(chan.feeA, chan.feerateA)
+                                   : cNoPolicy);
+    policyB.push_back(chan.policyB ? policies.add(chan.feeB, chan.feerateB)
+                                   : cNoPolicy);
+  }
+  auto adj = csr::build(nodes, nodeA, nodeB);
+
+  // ingest order, see renumbered()
+  std::vector<uint32_t> numbers(nodes);
+  for(size_t n = 0; n < nodes; n++) {
+    numbers[n] = static_cast<uint32_t>(n);
+  }
+
+  Sections sections;
+  sections.put(NodeIdOffsets, nodeIds.offsets());
+  sections.put(NodeIdChars, nodeIds.chars());
+  sections.put(NodeNameOffsets, nodeNames.offsets());
+  sections.put(NodeNameChars, nodeNames.chars());
+  sections.put(NodeOrigin, numbers);
+  sections.put(NodeNumber, numbers);
+  sections.put(ChannelId, channelIds);
+  sections.put(ChannelNodeA, nodeA);
+  sections.put(ChannelNodeB, nodeB);
+  sections.put(ChannelCapacity, capacity);
+  sections.put(ChannelPolicyA, policyA);
+  sections.put(ChannelPolicyB, policyB);
+  sections.put(PolicyFee, policies.fees());
+  sections.put(PolicyFeerate, policies.feerates());
+  sections.put(AdjOffsets, adj.offsets);
+  sections.put(AdjNode, adj.neighbours);
+  sections.put(AdjEdge, adj.edges);
+
+  return layout(sections, nodes, channels, g.capacity);
+}
+
+Snapshot Snapshot::renumbered(const std::vector<uint32_t>& permutation) const {
+  auto nodes = nodeCount();
+  auto channels = channelCount();
+  if(permutation.size() != nodes) {
+    throw std::runtime_error("permutation does not match the node count");
+  }
+  std::vector<uint32_t> sequence(nodes, 0); // old numbers in new order
+  for(size_t n = 0; n < nodes; n++) {
+    sequence[permutation[n]] = static_cast<uint32_t>(n);
+  }
+
+  StringPool nodeIds, nodeNames;
+  std::vector<uint32_t> origins(nodes), numbers(nodes);
+  for(size_t n = 0; n < nodes; n++) {
+    auto old = sequence[n];
+    nodeIds.add(nodeId(old));
+    nodeNames.add(nodeName(old));
+    origins[n] = origin(old);
+    numbers[n] = permutation[number(n)];
+  }
+
+  // channels keep their order, only the endpoints change
+  std::vector<uint32_t> nodeA(channels), nodeB(channels);
+  for(size_t c = 0; c < channels; c++) {
+    nodeA[c] = permutation[this->nodeA(c)];
+    nodeB[c] = permutation[this->nodeB(c)];
+  }
+  auto adj = csr::build(nodes, nodeA, nodeB);
+
+  Sections sections;
+  auto copy = [&](Section s) {
+    auto p = section<char>(s);
+    sections.data[s].assign(p, p + header_->sections[s].size);
+  };
+  sections.put(NodeIdOffsets, nodeIds.offsets());
+  sections.put(NodeIdChars, nodeIds.chars());
+  sections.put(NodeNameOffsets, nodeNames.offsets());
+  sections.put(NodeNameChars, nodeNames.chars());
+  sections.put(NodeOrigin, origins);
+  sections.put(NodeNumber, numbers);
+  copy(ChannelId);
+  sections.put(ChannelNodeA, nodeA);
+  sections.put(ChannelNodeB, nodeB);
+  for(auto s : {ChannelCapacity, ChannelPolicyA, ChannelPolicyB,
+                PolicyFee, PolicyFeerate}) {
+    copy(s);
+  }
+  sections.put(AdjOffsets, adj.offsets);
+  sections.put(AdjNode, adj.neighbours);
+  sections.put(AdjEdge, adj.edges);
+
+  return layout(sections, nodes, channels, capacity());
+}
+
+Snapshot Snapshot::layout(const Sections& sections, size_t nodes,
+                          size_t channels, int64_t capacity) {
+  Header header{};
+  std::memcpy(header.magic, cMagic, sizeof(cMagic));
+  header.version = cVersion;
+  header.sectionCount = SectionCount;
+  header.nodes = nodes;
+  header.channels = channels;
+  header.policies = sections.data[PolicyFee].size() / sizeof(int64_t);
+  header.capacity = capacity;
+
+  size_t size = align8(sizeof(Header));
+  for(uint32_t i = 0; i < SectionCount; i++) {
+    header.sections[i].offset = size;
+    header.sections[i].size = sections.data[i].size();
+    size = align8(size + sections.data[i].size());
+  }
+
+  Snapshot s;
+  s.memory_.resize(size / sizeof(uint64_t));
+  auto base = reinterpret_cast<char*>(s.memory_.data());
+  std::memcpy(base, &header, sizeof(header));
+  for(uint32_t i = 0; i < SectionCount; i++) {
+    if(!sections.data[i].empty()) {
+      std::memcpy(base + header.sections[i].offset,
+                  sections.data[i].data(), sections.data[i].size());
+    }
+  }
+  s.base_ = base;
+  s.size_ = size;
+  s.header_ = reinterpret_cast<const Header*>(base);
+  return s;
+}
+
+void Snapshot::write(const std::string& path) const {
+  std::ofstream t(path, std::ios::out | std::ofstream::binary);
+  if(!t.write(base_, static_cast<std::streamsize>(size_))) {
+    throw std::runtime_error("cannot write snapshot " + path);
+  }
+}
+
+// checks the header and the section table against the file size.
+// section contents are trusted, so this is O(1).
+void Snapshot::validate(size_t size) const {
+  if(size < sizeof(Header)) {
+    throw std::runtime_error("snapshot truncated");
+  }
+  Header h;
+  std::memcpy(&h, base_, sizeof(h));
+  if(std::memcmp(h.magic, cMagic, sizeof(cMagic)) != 0) {
+    throw std::runtime_error("not a graph snapshot");
+  }
+  if(h.version != cVersion || h.sectionCount != SectionCount) {
+    throw std::runtime_error("unsupported snapshot version "
+                             + std::to_string(h.version));
+  }
+
+  for(uint32_t i = 0; i < SectionCount; i++) {
+    auto& s = h.sections[i];
+    if(s.offset % 8 != 0 || s.offset > size || s.size > size - s.offset) {
+      throw std::runtime_error("snapshot section " + std::to_string(i)
+                               + " out of bounds");
+    }
+  }
+
+  auto expect = [&](Section s, size_t bytes) {
+    if(h.sections[s].size != bytes) {
+      throw std::runtime_error("snapshot section " + std::to_string(s)
+                               + " has unexpected size");
+    }
+  };
+  expect(NodeIdOffsets, expectedSize<uint32_t>(h.nodes + 1));
+  expect(NodeNameOffsets, expectedSize<uint32_t>(h.nodes + 1));
+  expect(NodeOrigin, expectedSize<uint32_t>(h.nodes));
+  expect(NodeNumber, expectedSize<uint32_t>(h.nodes));
+  expect(ChannelId, expectedSize<uint64_t>(h.channels));
+  expect(ChannelNodeA, expectedSize<uint32_t>(h.channels));
+  expect(ChannelNodeB, expectedSize<uint32_t>(h.channels));
+  expect(ChannelCapacity, expectedSize<int64_t>(h.channels));
+  expect(ChannelPolicyA, expectedSize<uint32_t>(h.channels));
+  expect(ChannelPolicyB, expectedSize<uint32_t>(h.channels));
+  expect(PolicyFee, expectedSize<int64_t>(h.policies));
+  expect(PolicyFeerate, expectedSize<int64_t>(h.policies));
+  expect(AdjOffsets, expectedSize<uint32_t>(h.nodes + 1));
+  expect(AdjNode, expectedSize<uint32_t>(2 * h.channels));
+  expect(AdjEdge, expectedSize<uint32_t>(2 * h.channels));
+
+  // the last string offset has to match the size of the pool
+  auto lastOffset = [&](Section s, uint64_t count) {
+    uint32_t o;
+    std::memcpy(&o, base_ + h.sections[s].offset + count * sizeof(uint32_t),
+                sizeof(o));
+    return o;
+  };
+  if(lastOffset(NodeIdOffsets, h.nodes) != h.sections[NodeIdChars].size
+     || lastOffset(NodeNameOffsets, h.nodes) != h.sections[NodeNameChars].size) {
+    throw std::runtime_error("snapshot string pool corrupt");
+  }
+}
+}
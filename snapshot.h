@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "csr.h"
+#include "inputBuffer.h"
+#include "lnGraph.h"
+
+// compiled, read-only form of a Graph.
+//
+// the file is a header followed by 8 byte aligned sections:
+// string pools for pub_keys and aliases (offsets + chars), the mapping
+// between node numbers and the ones assigned while loading, the channels
+// as structure of arrays (short channel id, endpoints, capacity, policy
+// ids), the distinct fee policies and a CSR adjacency (per node offsets,
+// neighbour numbers and directed edge ids, see csr::Graph).
+// integers are stored in native (little endian) byte order.
+//
+// opening a snapshot maps the file and only validates the header, no
+// parsing or per-object allocation happens.
+namespace snapshot {
+
+constexpr char cMagic[8] = {'L', 'N', 'M', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t cVersion = 6;
+
+// policy id of a direction without a policy, it can't route payments
+constexpr uint32_t cNoPolicy = UINT32_MAX;
+
+enum Section : uint32_t {
+  NodeIdOffsets,    // uint32[nodes + 1]
+  NodeIdChars,      // char[]
+  NodeNameOffsets,  // uint32[nodes + 1]
+  NodeNameChars,    // char[]
+  NodeOrigin,       // uint32[nodes], number of the node when it was loaded
+  NodeNumber,       // uint32[nodes], current number by loaded number
+  ChannelId,        // uint64[channels], short channel id
+  ChannelNodeA,     // uint32[channels]
+  ChannelNodeB,     // uint32[channels]
+  ChannelCapacity,  // int64[channels], satoshi
+  ChannelPolicyA,   // uint32[channels], policy id of A -> B or cNoPolicy
+  ChannelPolicyB,   // uint32[channels], policy id of B -> A or cNoPolicy
+  PolicyFee,        // int64[policies], millisatoshi
+  PolicyFeerate,    // int64[policies], one millionth
+  AdjOffsets,       // uint32[nodes + 1]
+  AdjNode,          // uint32[2 * channels]
+  AdjEdge,          // uint32[2 * channels], 2 * channel + direction
+  SectionCount
+};
+
+struct SectionEntry {
+  uint64_t offset; // from the start of the file
+  uint64_t size;   // in bytes
+};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t sectionCount;
+  uint64_t nodes;
+  uint64_t channels;
+  uint64_t policies; // distinct (fee, feerate) pairs
+  int64_t capacity; // satoshi
+  SectionEntry sections[SectionCount];
+};
+
+// true if the file starts with the snapshot magic
+bool isSnapshot(const std::string& path);
+
+class Snapshot
+{
+public:
+  // maps a snapshot file written by write()
+  static Snapshot open(const std::string& path);
+  // compiles a graph into an in-memory snapshot
+  static Snapshot fromGraph(const Graph& g);
+
+  // copy with node n renumbered to permutation[n]. channels keep their
+  // order, origin() and number() still refer to the numbers assigned
+  // while loading.
+  Snapshot renumbered(const std::vector<uint32_t>& permutation) const;
+
+  void write(const std::string& path) const;
+
+  size_t nodeCount() const { return header_->nodes; }
+  size_t channelCount() const { return header_->channels; }
+  size_t policyCount() const { return header_->policies; }
+  int64_t capacity() const { return header_->capacity; }
+
+  std::string_view nodeId(size_t n) const {
+    return string(NodeIdOffsets, NodeIdChars, n);
+  }
+  std::string_view nodeName(size_t n) const {
+    return string(NodeNameOffsets, NodeNameChars, n);
+  }
+
+  // number node n had when the graph was loaded
+  uint32_t origin(size_t n) const { return section<uint32_t>(NodeOrigin)[n]; }
+  // current number of the node loaded as number origin
+  uint32_t number(size_t origin) const { return section<uint32_t>(NodeNumber)[origin]; }
+
+  uint64_t channelId(size_t c) const { return section<uint64_t>(ChannelId)[c]; }
+  uint32_t nodeA(size_t c) const { return section<uint32_t>(ChannelNodeA)[c]; }
+  uint32_t nodeB(size_t c) const { return section<uint32_t>(ChannelNodeB)[c]; }
+  int64_t capacity(size_t c) const { return section<int64_t>(ChannelCapacity)[c]; }
+  uint32_t policyA(size_t c) const { return section<uint32_t>(ChannelPolicyA)[c]; }
+  uint32_t policyB(size_t c) const { return section<uint32_t>(ChannelPolicyB)[c]; }
+
+  // fee policies shared by the channels, numbered by first use
+  int64_t fee(size_t p) const { return section<int64_t>(PolicyFee)[p]; }
+  int64_t feerate(size_t p) const { return section<int64_t>(PolicyFeerate)[p]; }
+
+  // adjacency shared by all analyses, valid as long as the snapshot
+  csr::Graph csr() const {
+    return {nodeCount(), channelCount(), section<uint32_t>(AdjOffsets),
+            section<uint32_t>(AdjNode), section<uint32_t>(AdjEdge)};
+  }
+  // number of channels of node n
+  size_t degree(size_t n) const {
+    auto offsets = section<uint32_t>(AdjOffsets);
+    return offsets[n + 1] - offsets[n];
+  }
+
+  template <typename T>
+  const T* section(Section s) const {
+    return reinterpret_cast<const T*>(base_ + header_->sections[s].offset);
+  }
+
+private:
+  struct Sections;
+
+  Snapshot() = default;
+
+  static Snapshot layout(const Sections& sections, size_t nodes,
+                         size_t channels, int64_t capacity);
+
+  void validate(size_t size) const;
+
+  std::string_view string(Section offsets, Section chars, size_t i) const {
+    auto o = section<uint32_t>(offsets);
+    return {section<char>(chars) + o[i], o[i + 1] - o[i]};
+  }
+
+  const char* base_ = nullptr;
+  const Header* header_ = nullptr;
+  size_t size_ = 0;
+
+  std::unique_ptr<InputBuffer> file_;
+  std::vector<uint64_t> memory_;
+};
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+// strings stored back to back in one buffer, addressed by their number.
+// string i is chars()[offsets()[i], offsets()[i + 1]).
+class StringPool
+{
+public:
+  uint32_t add(std::string_view s) {
+    chars_.insert(chars_.end(), s.begin(), s.end());
+    if(chars_.size() > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("string pool exceeds 4 GB");
+    }
+    offsets_.push_back(static_cast<uint32_t>(chars_.size()));
+    return static_cast<uint32_t>(offsets_.size() - 2);
+  }
+
+  std::string_view get(uint32_t i) const {
+    return {chars_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]};
+  }
+
+  size_t size() const { return offsets_.size() - 1; }
+
+  void reserve(size_t strings, size_t chars) {
+    offsets_.reserve(strings + 1);
+    chars_.reserve(chars);
+  }
+
+  const std::vector<uint32_t>& offsets() const { return offsets_; }
+  const std::vector<char>& chars() const { return chars_; }
+
+private:
+  std::vector<uint32_t> offsets_{0};
+  std::vector<char> chars_;
+};